@@ -0,0 +1,220 @@
+#include "LRTDP.h"
+
+LRTDP::LRTDP(LRTDP_PARAMS& params, Maze * maze){
+    PlanParams = params;
+    this->maze = maze;
+    cols = maze->getCols();
+
+    double step, out, trapped;
+    maze->getRewards(step, out, trapped, rGoal);
+    rBest = std::max(step, std::max(out, trapped));
+
+    backups = 0;
+    trials = 0;
+}
+
+/*
+ * Every reward before reaching the goal is at most rBest, the goal cannot be reached in fewer than d = Manhattan distance steps, and the goal is terminal.
+ * The return of reaching the goal after t >= d steps is at most rBest*(1 - gamma^(t-1))/(1 - gamma) + gamma^(t-1)*rGoal, which is monotonic in t, so the larger of t = d and t -> infinity bounds V(s).
+ */
+double LRTDP::Heuristic(const State& s) const{
+    if(maze->isTerminal(s)) return 0.0;
+
+    const State& goal = maze->getGoal();
+    int d = std::abs(s.row - goal.row) + std::abs(s.col - goal.col);
+    double gamma = PlanParams.discount;
+    double g = std::pow(gamma, d - 1);
+    double never = rBest / (1 - gamma);
+    return std::max(never * (1 - g) + g * rGoal, never);
+}
+
+LRTDP::NODE& LRTDP::node(const State& s){
+    auto it = table.find(index(s));
+    if(it != table.end()) return it->second;
+
+    NODE& n = table[index(s)];
+    n.value = Heuristic(s);
+    n.solved = maze->isTerminal(s);
+    n.mark = false;
+    return n;
+}
+
+double LRTDP::Greedy(const State& s, int& action){
+    double best = -Infinity;
+    action = 0;
+    for(int a=0; a < maze->getNumActions(); a++){
+        maze->expandMDP(s, a, nextStates, reward, probability);
+
+        //Sum over s' of p(s')[r + gamma*V(s')]
+        double q = 0;
+        for(int s_p=0; s_p < nextStates.size(); s_p++)
+            q += probability[s_p] * (reward[s_p] + PlanParams.discount*node(nextStates[s_p]).value);
+        if(q > best){
+            best = q;
+            action = a;
+        }
+
+        nextStates.clear();
+        reward.clear();
+        probability.clear();
+    }
+    return best;
+}
+
+int LRTDP::Update(const State& s){
+    int action;
+    double q = Greedy(s, action);
+    node(s).value = q;
+    backups++;
+    return action;
+}
+
+/*
+ * Follow the greedy policy from the start until a solved state is reached, then try to label the visited states in reverse order
+ */
+void LRTDP::Trial(const State& start){
+    vector<State> visited;
+    State s(start);
+    double r;
+
+    while(!node(s).solved && (int)visited.size() < PlanParams.maxDepth){
+        visited.push_back(s);
+        double previous = node(s).value;
+        int action = Update(s);
+        maze->Step(s, action, r);
+
+        //Stuck in a trap whose value has converged: CheckSolved can label it now
+        if(s.row == visited.back().row && s.col == visited.back().col && std::abs(node(s).value - previous) <= PlanParams.epsilon) break;
+    }
+
+    while(!visited.empty()){
+        State last(visited.back());
+        visited.pop_back();
+        if(!CheckSolved(last, PlanParams.epsilon)) break;
+    }
+}
+
+/*
+ * Search the states reachable from s under the greedy policy, without going past solved states.
+ * If all of them have a residual of at most epsilon they are labeled as solved, otherwise they are backed up (in reverse order).
+ */
+bool LRTDP::CheckSolved(const State& s, double epsilon){
+    bool rv = true;
+    vector<State> open;
+    vector<State> closed;
+    vector<State> successors;
+    vector<double> rewards;
+    vector<float> probabilities;
+
+    if(!node(s).solved){
+        open.push_back(s);
+        node(s).mark = true;
+    }
+
+    while(!open.empty()){
+        State current(open.back());
+        open.pop_back();
+        closed.push_back(current);
+
+        int action;
+        double q = Greedy(current, action);
+        if(std::abs(q - node(current).value) > epsilon){
+            rv = false;
+            continue;
+        }
+
+        //Expand the greedy action
+        maze->expandMDP(current, action, successors, rewards, probabilities);
+        for(int s_p=0; s_p < successors.size(); s_p++){
+            if(probabilities[s_p] <= 0) continue;
+            NODE& n = node(successors[s_p]);
+            if(!n.solved && !n.mark){
+                n.mark = true;
+                open.push_back(successors[s_p]);
+            }
+        }
+        successors.clear();
+        rewards.clear();
+        probabilities.clear();
+    }
+
+    if(rv){
+        for(State& c : closed){
+            NODE& n = node(c);
+            n.solved = true;
+            n.mark = false;
+        }
+    }
+    else{
+        while(!closed.empty()){
+            node(closed.back()).mark = false;
+            Update(closed.back());
+            closed.pop_back();
+        }
+    }
+    return rv;
+}
+
+void LRTDP::Plan(){
+    Plan(PlanParams.epsilon);
+}
+
+void LRTDP::Plan(double epsilon){
+    if(!maze->isTerminal(maze->getGoal()))
+        std::cerr << "Warning: LRTDP needs a terminal goal, trials only end at maxDepth." << endl;
+
+    PlanParams.epsilon = epsilon;
+    State start(*PlanParams.startstate);
+    while(!node(start).solved){
+        Trial(start);
+        trials++;
+    }
+
+    long solved = 0;
+    for(auto& entry : table)
+        if(entry.second.solved) solved++;
+    cout << "LRTDP finished after " << trials << " trials, touching " << table.size() << " of " << maze->getNumStates()
+         << " states (" << solved << " solved)." << endl;
+}
+
+double LRTDP::getValue(const State& s) const{
+    auto it = table.find(index(s));
+    return it != table.end() ? it->second.value : Heuristic(s);
+}
+
+int LRTDP::getAction(const State& s){
+    int action;
+    Greedy(s, action);
+    return action;
+}
+
+bool LRTDP::isSolved(const State& s) const{
+    auto it = table.find(index(s));
+    return it != table.end() && it->second.solved;
+}
+
+void LRTDP::getStates(vector<int>& states) const{
+    for(auto& entry : table)
+        states.push_back(entry.first);
+}
+
+void LRTDP::DisplayPolicy(){
+    DisplayPolicy(cout);
+}
+
+void LRTDP::DisplayPolicy(std::ostream& ostr){
+    for(int r=0; r < maze->getRows(); r++){
+        for(int c=0; c < cols; c++){
+            State s(r, c);
+            ostr << "[";
+            if(maze->isTerminal(s))
+                ostr << "G";
+            else if(isSolved(s))
+                maze->DisplayAction(getAction(s), ostr);
+            else
+                ostr << " ";
+            ostr << "]";
+        }
+        ostr << endl;
+    }
+}
@@ -0,0 +1,90 @@
+/* LRTDP
+ *
+ * Labeled real-time dynamic programming (Bonet & Geffner, 2003)
+ * by Juan Carlos Saborio,
+ * DFKI Labor Niedersachsen (2021)
+ *
+ * LRTDP solves the MDP only for the states that are relevant from the start state.
+ * Trials follow the greedy policy from the start, sampling successors with Maze::Step, and back up every state they visit with Maze::expandMDP.
+ * Values start from an admissible heuristic, so states that the greedy policy never reaches are never expanded.
+ * At the end of a trial, CheckSolved labels a state as solved once every state reachable from it under the greedy policy has a residual below epsilon, and trials stop at solved states.
+ * Planning finishes when the start state is solved.
+ *
+ * The goal must be terminal (PARAMS::terminalGoal), so trials end there.
+ */
+
+#ifndef LRTDP_H
+#define LRTDP_H
+
+#define Infinity 1e+10
+
+#include <vector>
+#include <iostream>
+#include <ostream>
+#include <cmath>
+#include <chrono>
+#include <unordered_map>
+#include "maze.h"
+
+using std::vector;
+using std::cout;
+using std::endl;
+
+/*
+ * Planning parameters
+ */
+struct LRTDP_PARAMS{
+    State* startstate = 0; //Start state
+    float discount; //Discount factor for expected returns
+    double epsilon = 1e-6; //Max. residual of a solved state
+    int maxDepth = 10000; //Max. length of a trial (traps with p_traps = 1 are never left)
+};
+
+class LRTDP{
+    private:
+        struct NODE{
+            double value; //Current value estimate
+            bool solved; //Value and greedy policy have converged in this state and all its greedy successors
+            bool mark; //Visited by CheckSolved
+        };
+
+        LRTDP_PARAMS PlanParams;
+        Maze * maze; //The planning domain
+        int cols;
+        std::unordered_map<int, NODE> table; //Only the states touched so far
+        double rBest, rGoal; //Best non-goal reward and goal reward, for the heuristic
+        long backups; //No. of backups
+        long trials; //No. of trials
+
+        //Scratch vectors for expandMDP
+        vector<State> nextStates;
+        vector<double> reward;
+        vector<float> probability;
+
+        int index(const State& s) const { return s.row * cols + s.col; }
+        NODE& node(const State& s); //Find the entry of s, or add it with the heuristic value
+        double Heuristic(const State& s) const; //Upper bound of V(s)
+        double Greedy(const State& s, int& action); //Best Q-value in s and its action
+        int Update(const State& s); //Back up s and return the greedy action
+        void Trial(const State& start);
+        bool CheckSolved(const State& s, double epsilon);
+
+    public:
+        LRTDP(LRTDP_PARAMS& PlanParams, Maze * maze);
+
+        void Plan(); //LRTDP using the epsilon in LRTDP_PARAMS
+        void Plan(double epsilon); //LRTDP until the start state is solved with the given epsilon
+
+        double getValue(const State& s) const; //Heuristic value if s was not touched
+        int getAction(const State& s); //Greedy action in s
+        bool isSolved(const State& s) const;
+        void getStates(vector<int>& states) const; //Indices of the states touched
+        long getStatesTouched() const { return table.size(); }
+        long getBackups() const { return backups; }
+        long getTrials() const { return trials; }
+
+        void DisplayPolicy(); //Greedy action of the solved states
+        void DisplayPolicy(std::ostream& ostr);
+};
+
+#endif
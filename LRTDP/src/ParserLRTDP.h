@@ -0,0 +1,146 @@
+/* 
+ * Problem file parser
+ * 
+ * Adapted from a previous parser.
+ * 
+ * Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ */
+
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include "maze.h"
+#include "LRTDP.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace PARSER{
+    
+    struct COMMAND_LINE{
+        string inputFile = "none";
+        double epsilon = 0; //0 = error in the problem file
+        int maxDepth = 10000;
+        int compare = 0;
+        int display = 1;
+    };
+    
+    void parseCommandLine(char ** argv, int argc, COMMAND_LINE& cl){        
+        string param, value;
+        for(int i=1; i<argc; i+=2){
+            param = argv[i];
+            
+            if(argc > i+1) value = argv[i+1];
+            if(param == "--help"){
+                cout << "Labeled RTDP for the Maze problem" << endl;
+                cout << "Parameters" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--inputFile";
+                cout << std::left << std::setw(100) << "Problem specification file (uses startR/startC)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--epsilon";
+                cout << std::left << std::setw(100) << "Max. residual of solved states (default = error in the problem file, or 1e-6)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--maxDepth";
+                cout << std::left << std::setw(100) << "Max. length of a trial (default = 10000)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--compare";
+                cout << std::left << std::setw(100) << "Also run VI with the same error and report time, backups, states touched and value difference (default = 0)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--display";
+                cout << std::left << std::setw(100) << "Display the maze and the policy of the solved states (default = 1)" << endl;
+                
+                exit(0);
+            }
+            
+            else if(param == "--inputFile")
+                cl.inputFile = value;
+            else if(param == "--epsilon")
+                cl.epsilon = stod(value);
+            else if(param == "--maxDepth")
+                cl.maxDepth = stoi(value);
+            else if(param == "--compare")
+                cl.compare = stoi(value);
+            else if(param == "--display")
+                cl.display = stoi(value);
+            else
+                cout << "Unrecognized parameter \"" << param << "\"" << endl;
+        }
+        
+    }
+           
+    bool parseMaze(PARAMS& mazeParams, LRTDP_PARAMS& lrtdpParams, string inputFile){
+        std::ifstream infile(inputFile);
+
+        if(!infile.is_open()){
+            cout << "Could not open file \"" << inputFile << "\"." << endl;
+            return false;
+        }
+        
+        string param, s_value;
+        int goalC = 0;
+        int goalR = 0;
+        int startC = 0;
+        int startR = 0;
+        while(infile >> param >> s_value){
+            if(param == "cols")
+                mazeParams.cols = stoi(s_value);
+            else if(param == "rows")
+                mazeParams.rows = stoi(s_value);
+            else if(param == "traps")
+                mazeParams.traps = stoi(s_value);
+            else if(param == "p_traps")
+                mazeParams.p_traps = stof(s_value);            
+            else if(param == "discount")
+                lrtdpParams.discount = stof(s_value);            
+            else if(param == "error")
+                lrtdpParams.epsilon = stof(s_value);
+            else if(param == "rStep")
+                mazeParams.rStep = stod(s_value);
+            else if(param == "rOut")
+                mazeParams.rOut = stod(s_value);
+            else if(param == "rTrap")
+                mazeParams.rTrap = stod(s_value);
+            else if(param == "rGoal")
+                mazeParams.rGoal = stod(s_value);
+            else if(param == "goalC")
+                goalC = stoi(s_value);
+            else if(param == "goalR")
+                goalR = stoi(s_value);
+            else if(param == "startC")
+                startC = stoi(s_value);
+            else if(param == "startR")
+                startR = stoi(s_value);
+            else
+                cout << "\tWarning: \"" << param << "\" is not a valid parameter." << endl;
+        }
+        
+        infile.close();
+        
+        //If not set, goal is bottom right corner
+        if(goalC == 0) goalC = mazeParams.cols - 1;
+        if(goalR == 0) goalR = mazeParams.rows - 1;
+        
+        mazeParams.goal = new State(goalR, goalC);
+        mazeParams.terminalGoal = true; //Trials end at the goal
+        lrtdpParams.startstate = new State(startR, startC);
+        
+        cout << "Parsed Maze: " << mazeParams.rows << "x" << mazeParams.cols << ", " 
+             << mazeParams.traps << " traps, " << "p(traps) = " << mazeParams.p_traps 
+             << ", gamma = " << lrtdpParams.discount << ", epsilon = " << lrtdpParams.epsilon << endl;
+        
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Launcher for LRTDP using the Maze problem.
+ *
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021).
+ *
+ */
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include "maze.h"
+#include "vi.h"
+#include "LRTDP.h"
+#include "ParserLRTDP.h"
+
+using std::cout;
+using std::endl;
+
+int main(int argc, char ** argv){
+    PARAMS mazeParams;
+    LRTDP_PARAMS lrtdpParams;
+    PARSER::COMMAND_LINE cl;
+
+    PARSER::parseCommandLine(argv, argc, cl);
+
+    if(!PARSER::parseMaze(mazeParams, lrtdpParams, cl.inputFile)){
+        std::cerr << "Could not parse problem file." << endl;
+        return -1;
+    }
+
+    //Assign values parsed from command line
+    if(cl.epsilon > 0) lrtdpParams.epsilon = cl.epsilon;
+    lrtdpParams.maxDepth = cl.maxDepth;
+
+    //Create maze
+    Maze * M = new Maze(mazeParams);
+    if(!M->validateState(*lrtdpParams.startstate)){
+        std::cerr << "Start state is outside the maze." << endl;
+        return -1;
+    }
+    if(cl.display){
+        cout << "Maze: " << endl;
+        M->DisplayState(*lrtdpParams.startstate, cout);
+    }
+
+    //Create LRTDP (planner)
+    LRTDP lrtdp(lrtdpParams, M);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    lrtdp.Plan();
+    auto stop = std::chrono::high_resolution_clock::now();
+    double time = std::chrono::duration<double, std::milli>(stop - start).count();
+
+    State& s0 = *lrtdpParams.startstate;
+    cout << "LRTDP took " << time << " ms for " << lrtdp.getBackups() << " backups, V" << s0 << " = " << lrtdp.getValue(s0) << endl;
+
+    if(cl.display){
+        cout << "Policy (solved states): " << endl;
+        lrtdp.DisplayPolicy();
+    }
+
+    //VI solves every state with the same error, on the same maze
+    if(cl.compare){
+        VI_PARAMS viParams;
+        viParams.discount = lrtdpParams.discount;
+        VI vi(viParams, M);
+
+        start = std::chrono::high_resolution_clock::now();
+        vi.Plan(lrtdpParams.epsilon);
+        stop = std::chrono::high_resolution_clock::now();
+        double viTime = std::chrono::duration<double, std::milli>(stop - start).count();
+        cout << "VI took " << viTime << " ms." << endl;
+
+        //Values of the solved states, whose greedy policy LRTDP returns
+        vector<int> touched;
+        lrtdp.getStates(touched);
+        double maxDiff = 0.0;
+        for(int s : touched){
+            State state(s / M->getCols(), s % M->getCols());
+            if(lrtdp.isSolved(state))
+                maxDiff = std::max(maxDiff, std::abs(lrtdp.getValue(state) - vi.getValues()[s]));
+        }
+        int cols = M->getCols();
+        double v0 = vi.getValues()[s0.row*cols + s0.col];
+
+        cout << "States touched: " << lrtdp.getStatesTouched() << " (LRTDP) vs. " << M->getNumStates() << " (VI)" << endl;
+        cout << "Backups: " << lrtdp.getBackups() << " (LRTDP) vs. " << vi.getBackups() << " (VI)" << endl;
+        cout << "Time to epsilon = " << lrtdpParams.epsilon << ": " << time << " ms (LRTDP) vs. " << viTime << " ms (VI), speedup = " << viTime / time << endl;
+        cout << "V" << s0 << " = " << lrtdp.getValue(s0) << " (LRTDP) vs. " << v0 << " (VI), max. value difference over solved states = " << maxDiff << endl;
+        cout << "Greedy action in " << s0 << ": ";
+        M->DisplayAction(lrtdp.getAction(s0), cout);
+        cout << " (LRTDP) vs. ";
+        M->DisplayAction(vi.policy()[s0.row*cols + s0.col], cout);
+        cout << " (VI)" << endl;
+    }
+
+    delete M;
+
+    return 0;
+}
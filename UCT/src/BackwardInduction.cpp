@@ -0,0 +1,120 @@
+#include "BackwardInduction.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include "threadpool.h"
+
+#define Infinity 1e+10
+
+BackwardInduction::BackwardInduction(const Maze * maze, const State& goal, double discount, int threads){
+    MDP = maze;
+    this->discount = discount;
+    this->threads = threads;
+    numStates = maze->getNumStates();
+    numActions = maze->getNumActions();
+    this->goal = goal.row * maze->getCols() + goal.col;
+    horizon = 0;
+    time = 0;
+
+    Compile();
+    Vd.assign(numStates, 0.0);
+    Ud.assign(numStates, 0.0);
+    Wu.assign(numStates, 0.0);
+}
+
+/*
+ * expandMDP is called once per state-action pair, instead of once per pair and stage
+ */
+void BackwardInduction::Compile(){
+    vector<State> nextStates;
+    vector<double> rewards;
+    vector<float> probabilities;
+    int cols = MDP->getCols();
+
+    first.clear();
+    next.clear();
+    prob.clear();
+    reward.clear();
+    first.push_back(0);
+    for(int s=0; s < numStates; s++){
+        State state(s / cols, s % cols);
+        for(int a=0; a < numActions; a++){
+            MDP->expandMDP(state, a, nextStates, rewards, probabilities);
+            for(int i=0; i < nextStates.size(); i++){
+                next.push_back(nextStates[i].row * cols + nextStates[i].col);
+                prob.push_back(probabilities[i]);
+                reward.push_back(rewards[i]);
+            }
+            first.push_back(next.size());
+            nextStates.clear();
+            rewards.clear();
+            probabilities.clear();
+        }
+    }
+}
+
+void BackwardInduction::Solve(int numSteps){
+    auto start = std::chrono::high_resolution_clock::now();
+
+    int rows = MDP->getRows();
+    int cols = MDP->getCols();
+    int numThreads = threads > 0 ? threads : std::thread::hardware_concurrency();
+    numThreads = std::max(1, std::min(numThreads, rows));
+    ThreadPool pool(numThreads);
+
+    //Stage k-1 is read from the "prev" buffers and stage k written to Vd, Ud and Wu
+    vector<double> prevVd(numStates), prevUd(numStates), prevWu(numStates);
+    std::fill(Vd.begin(), Vd.end(), 0.0);
+    std::fill(Ud.begin(), Ud.end(), 0.0);
+    std::fill(Wu.begin(), Wu.end(), 0.0);
+
+    //Stage k of the states in band id (rows are split evenly)
+    std::function<void(int)> stage = [&](int id){
+        int firstState = (long)rows * id / numThreads * cols;
+        int lastState = (long)rows * (id+1) / numThreads * cols;
+
+        for(int s=firstState; s < lastState; s++){
+            double bestV = -Infinity, bestU = 0, bestW = -Infinity;
+            for(int a=0; a < numActions; a++){
+                double qv = 0, qu = 0, qw = 0;
+                for(int i=first[s*numActions + a]; i < first[s*numActions + a + 1]; i++){
+                    int n = next[i];
+                    double p = prob[i];
+                    double r = reward[i];
+                    if(n == goal){ //The episode ends at the goal
+                        qv += p * r;
+                        qu += p * r;
+                        qw += p * r;
+                    }
+                    else{
+                        qv += p * (r + discount * prevVd[n]);
+                        qu += p * (r + prevUd[n]);
+                        qw += p * (r + prevWu[n]);
+                    }
+                }
+                if(qv > bestV){ //Ties go to the first action
+                    bestV = qv;
+                    bestU = qu;
+                }
+                bestW = std::max(bestW, qw);
+            }
+            Vd[s] = bestV;
+            Ud[s] = bestU;
+            Wu[s] = bestW;
+        }
+    };
+
+    for(int k=1; k <= numSteps; k++){
+        Vd.swap(prevVd);
+        Ud.swap(prevUd);
+        Wu.swap(prevWu);
+        pool.Run(stage);
+    }
+    horizon = numSteps;
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration<double, std::milli>(stop - start).count();
+}
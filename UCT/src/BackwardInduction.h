@@ -0,0 +1,60 @@
+/* BackwardInduction
+ *
+ * Exact finite-horizon solver for the episodes played by UCT::Run
+ * by Juan Carlos Saborio,
+ * DFKI Labor Niedersachsen (2021)
+ *
+ * An episode lasts at most numSteps steps and ends when the goal is reached (Maze::Step returns terminal), so the optimal values depend on the no. of steps left.
+ * Stage k holds the values with k steps left: V_0 = 0 and V_k(s) = max_a sum_s' p(s'|s,a)[r + gamma*V_{k-1}(s')], where V_{k-1}(goal) = 0 since the episode has ended.
+ * Only two stages are kept in memory (rolling buffers), and each stage is computed in a single pass, optionally with the rows split across threads.
+ *
+ * Three values are computed in the same pass:
+ * - The optimal expected discounted return, which UCT approximates.
+ * - The expected undiscounted return of that (discount-optimal) policy, which corresponds to the undiscounted returns reported by Experiment().
+ * - The optimal expected undiscounted return, as an upper bound for the latter.
+ */
+
+#ifndef BACKWARDINDUCTION_H
+#define BACKWARDINDUCTION_H
+
+#include <vector>
+#include "maze.h"
+
+using std::vector;
+
+class BackwardInduction{
+    private:
+        const Maze * MDP;
+        double discount;
+        int threads; //Threads per stage (0 = all cores)
+        int numStates, numActions;
+        int goal; //Index of the (terminal) goal
+
+        //Transitions of every state-action pair, from expandMDP: outcomes first[s*numActions + a]...first[s*numActions + a + 1]-1
+        vector<int> first;
+        vector<int> next;
+        vector<double> prob;
+        vector<double> reward;
+
+        //Values of the last stage
+        vector<double> Vd; //Optimal discounted return
+        vector<double> Ud; //Undiscounted return of the discount-optimal policy
+        vector<double> Wu; //Optimal undiscounted return
+        int horizon; //No. of steps of the last stage
+        double time; //Time of the last Solve in ms
+
+        void Compile(); //Build the transition lists
+
+    public:
+        BackwardInduction(const Maze * maze, const State& goal, double discount, int threads = 1);
+
+        void Solve(int numSteps); //Compute the stages 1...numSteps
+
+        double getDiscountedReturn(const State& s) const { return Vd[s.row * MDP->getCols() + s.col]; }
+        double getUndiscountedReturn(const State& s) const { return Ud[s.row * MDP->getCols() + s.col]; }
+        double getOptimalUndiscountedReturn(const State& s) const { return Wu[s.row * MDP->getCols() + s.col]; }
+        int getHorizon() const { return horizon; }
+        double getTime() const { return time; }
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "FlatTree.h"
+
+#include <algorithm>
+
+FlatTree::FlatTree(const Maze * maze, bool transpositions){
+    MDP = maze;
+    numActions = maze->getNumActions();
+    cols = maze->getCols();
+    numNodes = 0;
+    numEdges = 0;
+    numChild = 0;
+
+    this->transpositions = transpositions;
+    generation = 1;
+    mask = 0;
+    if(transpositions){
+        slotNode.resize(1024);
+        slotGen.resize(1024, 0);
+        mask = 1023;
+    }
+}
+
+template<typename T>
+void FlatTree::Reserve(vector<T>& pool, uint32_t size){
+    if(size > pool.size())
+        pool.resize(std::max<size_t>(size, 2 * pool.size()));
+}
+
+/*
+ * Node ids are only handed out again after the counters are reset, so the pools keep their contents (and memory) and nothing needs to be freed
+ */
+void FlatTree::Reset(){
+    numNodes = 0;
+    numEdges = 0;
+    numChild = 0;
+    generation++;
+}
+
+/*
+ * Fibonacci hashing of the cell index
+ */
+uint32_t FlatTree::Slot(int key) const{
+    uint32_t i = ((uint32_t)key * 2654435769u) & mask;
+    while(slotGen[i] == generation && cell[slotNode[i]] != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+void FlatTree::Rehash(){
+    size_t size = 2 * slotNode.size();
+    slotNode.assign(size, 0);
+    slotGen.assign(size, 0);
+    mask = size - 1;
+    generation = 1;
+    for(uint32_t n=0; n < numNodes; n++){
+        uint32_t i = Slot(cell[n]);
+        slotNode[i] = n;
+        slotGen[i] = generation;
+    }
+}
+
+uint32_t FlatTree::AddNode(const State& s){
+    uint32_t slot = 0;
+    if(transpositions){
+        slot = Slot(s.row * cols + s.col);
+        if(slotGen[slot] == generation) return slotNode[slot];
+    }
+
+    assert(numNodes < None);
+    uint32_t n = numNodes++;
+    Reserve(cell, numNodes);
+    Reserve(count, numNodes);
+    Reserve(firstEdge, numNodes);
+    cell[n] = s.row * cols + s.col;
+    count[n] = 0;
+    firstEdge[n] = None;
+
+    //Keep the load factor at most 1/2
+    if(transpositions){
+        slotNode[slot] = n;
+        slotGen[slot] = generation;
+        if(2 * numNodes > slotNode.size()) Rehash();
+    }
+    return n;
+}
+
+/*
+ * Same successors as UCT::expandNode: one unexpanded node per outcome of every action, or with transpositions the node of its cell if it already exists
+ */
+void FlatTree::Expand(uint32_t n){
+    uint32_t e = numEdges;
+    numEdges += numActions;
+    Reserve(actionCount, numEdges);
+    Reserve(reward, numEdges);
+    Reserve(firstChild, numEdges);
+    Reserve(numChildren, numEdges);
+    firstEdge[n] = e;
+
+    State s = getState(n);
+    for(int a=0; a < numActions; a++, e++){
+        MDP->expandMDP(s, a, nextStates, rewards, probabilities);
+
+        //Children are added after the edge is set up, since AddNode may move the pools
+        actionCount[e] = 0;
+        reward[e] = 0;
+        firstChild[e] = numChild;
+        numChildren[e] = nextStates.size();
+        numChild += nextStates.size();
+        Reserve(child, numChild);
+        for(int i=0; i < nextStates.size(); i++)
+            child[firstChild[e] + i] = AddNode(nextStates[i]);
+
+        nextStates.clear();
+        rewards.clear();
+        probabilities.clear();
+    }
+}
+
+/*
+ * Breadth-first copy, so that the i-th node in the queue becomes node i of target and the children of every edge stay consecutive
+ */
+uint32_t FlatTree::CopySubtree(uint32_t n, FlatTree& target){
+    assert(!transpositions && !target.transpositions);
+    target.Reset();
+    queue.clear();
+    queue.push_back(n);
+    target.AddNode(getState(n));
+    
+    for(uint32_t i=0; i < queue.size(); i++){
+        uint32_t m = queue[i];
+        target.count[i] = count[m];
+        if(!expanded(m)) continue;
+        
+        uint32_t e = target.numEdges;
+        target.numEdges += numActions;
+        Reserve(target.actionCount, target.numEdges);
+        Reserve(target.reward, target.numEdges);
+        Reserve(target.firstChild, target.numEdges);
+        Reserve(target.numChildren, target.numEdges);
+        target.firstEdge[i] = e;
+        
+        for(uint32_t f=firstEdge[m]; f < firstEdge[m] + numActions; f++, e++){
+            target.actionCount[e] = actionCount[f];
+            target.reward[e] = reward[f];
+            target.firstChild[e] = target.numChild;
+            target.numChildren[e] = numChildren[f];
+            target.numChild += numChildren[f];
+            Reserve(target.child, target.numChild);
+            for(uint32_t c=firstChild[f]; c < firstChild[f] + numChildren[f]; c++){
+                target.child[target.firstChild[e] + c - firstChild[f]] = target.AddNode(getState(child[c]));
+                queue.push_back(child[c]);
+            }
+        }
+    }
+    return 0;
+}
+
+size_t FlatTree::getMemory() const{
+    return cell.capacity() * sizeof(int32_t) + count.capacity() * sizeof(int32_t) + firstEdge.capacity() * sizeof(uint32_t)
+         + actionCount.capacity() * sizeof(int32_t) + reward.capacity() * sizeof(double) + firstChild.capacity() * sizeof(uint32_t) + numChildren.capacity() * sizeof(uint8_t)
+         + child.capacity() * sizeof(uint32_t) + slotNode.capacity() * sizeof(uint32_t) + slotGen.capacity() * sizeof(uint32_t);
+}
+
+size_t FlatTree::getUsedMemory() const{
+    return (size_t)numNodes * (2*sizeof(int32_t) + sizeof(uint32_t)) + (size_t)numEdges * (sizeof(int32_t) + sizeof(double) + sizeof(uint32_t) + sizeof(uint8_t))
+         + (size_t)numChild * sizeof(uint32_t) + slotNode.size() * 2*sizeof(uint32_t);
+}
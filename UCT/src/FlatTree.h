@@ -0,0 +1,126 @@
+/* FlatTree
+ *
+ * UCT search tree in contiguous arena storage
+ * by Juan Carlos Saborio,
+ * DFKI Labor Niedersachsen (2021)
+ *
+ * Holds the same statistics as Node, but as structure-of-arrays pools indexed by 32-bit ids instead of individually allocated objects:
+ * - Nodes: maze cell, visit count and the first of its edges.
+ * - Edges: numActions consecutive edges per expanded node, with the action count, reward sum and the first of its children.
+ * - Children: the successor nodes of every edge, one per outcome of expandMDP, stored consecutively.
+ * Adding a node or expanding it appends to the pools, and Reset empties them in O(1) while keeping their memory for the next run.
+ * Subtrees cannot be freed individually: to move the root, CopySubtree copies the subtree that is kept into a second tree, and the old one is reset.
+ *
+ * With transpositions, the tree becomes a graph with one node per maze cell: a hash table (open addressing, linear probing) maps every cell to its node, and expanding a node links to the existing nodes of its successors.
+ * All paths that reach a cell then share its visit count and the Q estimates of its actions, so UCB needs no changes.
+ * Since the maze has cycles, so does the graph, and only the search depth ends a simulation.  Backing up the sampled return of a simulation would then feed every loop around a cycle back into the same Q estimates (the agent ends up oscillating between two cells), so UCT::SimulateFlat backs up r + gamma*getNodeValue(s') instead (UCT3 in Childs et al., 2008).
+ */
+
+#ifndef FLATTREE_H
+#define FLATTREE_H
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include "maze.h"
+
+using std::vector;
+
+class FlatTree{
+    private:
+        const Maze * MDP;
+        int numActions, cols;
+
+        //Node pool
+        vector<int32_t> cell; //Maze cell (row*cols + col)
+        vector<int32_t> count; //Times the node has been visited
+        vector<uint32_t> firstEdge; //Edges of the node, or None if not expanded
+        uint32_t numNodes;
+
+        //Edge pool
+        vector<int32_t> actionCount; //No. of times the action has been executed
+        vector<double> reward; //Sum of rewards of the action
+        vector<uint32_t> firstChild; //Successors of the action
+        vector<uint8_t> numChildren;
+        uint32_t numEdges;
+
+        //Child pool
+        vector<uint32_t> child;
+        uint32_t numChild;
+
+        //Transposition table: slot i holds node slotNode[i] if slotGen[i] == generation, so Reset only needs to increment generation
+        bool transpositions;
+        vector<uint32_t> slotNode;
+        vector<uint32_t> slotGen;
+        uint32_t generation;
+        uint32_t mask; //No. of slots - 1 (a power of 2)
+
+        //Scratch space for expandMDP
+        vector<State> nextStates;
+        vector<double> rewards;
+        vector<float> probabilities;
+        vector<uint32_t> queue; //Scratch space for CopySubtree
+
+        template<typename T> static void Reserve(vector<T>& pool, uint32_t size); //Grow pool to hold at least size elements
+        uint32_t Slot(int key) const; //Slot of cell key, or the empty slot where it belongs
+        void Rehash(); //Double the table
+
+    public:
+        static const uint32_t None = 0xFFFFFFFF;
+
+        FlatTree(const Maze * maze, bool transpositions = false);
+
+        void Reset(); //Remove all nodes, in O(1)
+        uint32_t AddNode(const State& s); //Add an unexpanded node and return its id.  With transpositions, return the node of s if there is one
+        void Expand(uint32_t n); //Create all successors of node n
+        uint32_t CopySubtree(uint32_t n, FlatTree& target); //Replace target with a copy of the subtree of n and return its root.  Not available with transpositions
+
+        bool expanded(uint32_t n) const { return firstEdge[n] != None; }
+        int getCount(uint32_t n) const { return count[n]; }
+        void increaseCount(uint32_t n) { count[n]++; }
+        int getActionCount(uint32_t n, int a) const { return actionCount[firstEdge[n] + a]; }
+        double getValue(uint32_t n, int a) const; //Compute Q(s,a)
+        void Update(uint32_t n, int a, double r); //Count a visit of (s,a) and add its reward
+        uint32_t getSuccessor(uint32_t n, int a, const State& s) const; //Successor of action a that matches state s
+        double getNodeValue(uint32_t n) const; //Mean return of all visits of n, over all actions
+        State getState(uint32_t n) const { return State(cell[n] / cols, cell[n] % cols); }
+
+        uint32_t getNumNodes() const { return numNodes; }
+        bool hasTranspositions() const { return transpositions; }
+        size_t getMemory() const; //Bytes allocated by the pools
+        size_t getUsedMemory() const; //Bytes used by the current tree
+};
+
+inline double FlatTree::getValue(uint32_t n, int a) const{
+    uint32_t e = firstEdge[n] + a;
+    return actionCount[e] ? reward[e] / actionCount[e] : reward[e];
+}
+
+inline void FlatTree::Update(uint32_t n, int a, double r){
+    uint32_t e = firstEdge[n] + a;
+    count[n]++;
+    actionCount[e]++;
+    reward[e] += r;
+}
+
+inline double FlatTree::getNodeValue(uint32_t n) const{
+    double sum = 0.0;
+    int visits = 0;
+    for(uint32_t e=firstEdge[n]; e < firstEdge[n] + numActions; e++){
+        sum += reward[e];
+        visits += actionCount[e];
+    }
+    return visits ? sum / visits : 0.0;
+}
+
+inline uint32_t FlatTree::getSuccessor(uint32_t n, int a, const State& s) const{
+    assert(expanded(n) && a >= 0 && a < numActions);
+    uint32_t e = firstEdge[n] + a;
+    int target = s.row * cols + s.col;
+    uint32_t next = None;
+    for(uint32_t i=firstChild[e]; i < firstChild[e] + numChildren[e]; i++)
+        if(cell[child[i]] == target) next = child[i];
+    return next;
+}
+
+#endif
@@ -32,6 +32,14 @@ namespace PARSER{
         int runs = 1;
         int verbose = 1;
         bool solve = false;
+        int exact = -1; //Threads for backward induction (-1 = off)
+        string tree = "flat";
+        int threads = 1;
+        string parallel = "root";
+        double virtualLoss = 10;
+        int rollouts = 1;
+        bool benchmark = false;
+        string policyFile = "none";
     };
     
     void parseCommandLine(char ** argv, int argc, COMMAND_LINE& cl){        
@@ -72,10 +80,42 @@ namespace PARSER{
                 cout << std::left << std::setw(20) << "--verbose";
                 cout << std::left << std::setw(100) << "Verbosity level (default = 1)" << endl;      
                 
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--policy";
+                cout << std::left << std::setw(100) << "Binary policy file written by VI (maze --export), used as rollout policy" << endl;
+                
                 cout << std::setw(3) << "";
                 cout << std::left << std::setw(20) << "--solve";
                 cout << std::left << std::setw(100) << "Generate deterministic policy using N simulations per step" << endl;
                 
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--tree";
+                cout << std::left << std::setw(100) << "Tree representation: flat (default, arena storage), dag (flat, one node per maze cell) or node (one object per node)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--threads";
+                cout << std::left << std::setw(100) << "Parallel search with N threads (default = 1)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--parallel";
+                cout << std::left << std::setw(100) << "root (default, one tree per thread, merged at the root to select each action), tree (all threads search one tree, ignores --tree) or leaf (the threads share the rollouts of every new leaf)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--virtualLoss";
+                cout << std::left << std::setw(100) << "Tree parallelization: reward subtracted from actions that other threads are simulating (default = 10)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--rollouts";
+                cout << std::left << std::setw(100) << "Rollouts from every new leaf, whose mean is backed up (default = 1)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--benchmark";
+                cout << std::left << std::setw(100) << "Compare both tree representations (and tree parallelization, if set) on one search with 2^N simulations" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--exact";
+                cout << std::left << std::setw(100) << "Also report the exact optimal returns for numSteps steps, using N threads (0 = all cores)" << endl;
+                
                 exit(0);
             }
             
@@ -93,10 +133,28 @@ namespace PARSER{
                 cl.runs = stoi(value);
             else if(param == "--verbose")
                 cl.verbose = stoi(value);
+            else if(param == "--policy")
+                cl.policyFile = value;
             else if(param == "--solve"){
                 cl.maxSims = stoi(value);
                 cl.solve = true;
             }
+            else if(param == "--tree")
+                cl.tree = value;
+            else if(param == "--threads")
+                cl.threads = stoi(value);
+            else if(param == "--parallel")
+                cl.parallel = value;
+            else if(param == "--virtualLoss")
+                cl.virtualLoss = stod(value);
+            else if(param == "--rollouts")
+                cl.rollouts = stoi(value);
+            else if(param == "--benchmark"){
+                cl.maxSims = stoi(value);
+                cl.benchmark = true;
+            }
+            else if(param == "--exact")
+                cl.exact = stoi(value);
             else
                 cout << "Unrecognized parameter \"" << param << "\"" << endl;
         }
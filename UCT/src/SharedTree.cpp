@@ -0,0 +1,89 @@
+#include "SharedTree.h"
+
+SharedNode::SharedNode(int cell){
+    this->cell = cell;
+    count.store(0, std::memory_order_relaxed);
+    for(int a=0; a < MaxActions; a++){
+        actionCount[a].store(0, std::memory_order_relaxed);
+        reward[a].store(0.0, std::memory_order_relaxed);
+        numSuccessors[a] = 0;
+    }
+    status.store(Unexpanded, std::memory_order_relaxed);
+}
+
+SharedNode::~SharedNode(){
+    if(!expanded()) return;
+    for(int a=0; a < MaxActions; a++)
+        for(int i=0; i < numSuccessors[a]; i++)
+            delete successors[a][i]; //Successors released by freeSuccessor are NULL
+}
+
+/*
+ * Same successors as UCT::expandNode.  Only the thread that wins the compare-exchange writes successors, and the release store of status makes them visible to the threads that load Expanded
+ */
+bool SharedNode::Expand(const Maze * MDP){
+    int unexpanded = Unexpanded;
+    if(!status.compare_exchange_strong(unexpanded, Expanding, std::memory_order_acquire))
+        return false;
+
+    //Scratch space for expandMDP, one per thread
+    thread_local vector<State> nextStates;
+    thread_local vector<double> rewards;
+    thread_local vector<float> probabilities;
+
+    int cols = MDP->getCols();
+    State s = getState(cols);
+    for(int a=0; a < MDP->getNumActions(); a++){
+        MDP->expandMDP(s, a, nextStates, rewards, probabilities);
+        assert(a < MaxActions && nextStates.size() <= MaxOutcomes);
+
+        numSuccessors[a] = nextStates.size();
+        for(int i=0; i < nextStates.size(); i++)
+            successors[a][i] = new SharedNode(nextStates[i].row * cols + nextStates[i].col);
+
+        nextStates.clear();
+        rewards.clear();
+        probabilities.clear();
+    }
+
+    status.store(Expanded, std::memory_order_release);
+    return true;
+}
+
+SharedNode * SharedNode::freeSuccessor(int a, const State& s, int cols){
+    SharedNode * next = getSuccessor(a, s, cols);
+    for(int i=0; i < numSuccessors[a]; i++)
+        if(successors[a][i] == next) successors[a][i] = 0;
+    return next;
+}
+
+long SharedNode::getNumNodes() const{
+    long nodes = 1;
+    if(expanded())
+        for(int a=0; a < MaxActions; a++)
+            for(int i=0; i < numSuccessors[a]; i++)
+                if(successors[a][i]) nodes += successors[a][i]->getNumNodes();
+    return nodes;
+}
+
+size_t SharedNode::getMemory() const{
+    return getNumNodes() * sizeof(SharedNode);
+}
+
+/*
+ * Every visit of an expanded node counts one of its actions, except for the first visit if it ended in a rollout
+ */
+bool SharedNode::Validate() const{
+    if(!expanded()) return true;
+
+    int visits = 0;
+    for(int a=0; a < MaxActions; a++)
+        visits += getActionCount(a);
+    if(getCount() - visits < 0 || getCount() - visits > 1)
+        return false;
+
+    for(int a=0; a < MaxActions; a++)
+        for(int i=0; i < numSuccessors[a]; i++)
+            if(successors[a][i] && !successors[a][i]->Validate()) return false;
+    return true;
+}
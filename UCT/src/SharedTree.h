@@ -0,0 +1,101 @@
+/* SharedTree
+ *
+ * UCT search tree shared by several threads (tree parallelization)
+ * by Juan Carlos Saborio,
+ * DFKI Labor Niedersachsen (2021)
+ *
+ * SharedNode holds the same statistics as Node, but all threads search the same tree at once:
+ * - Visit counts and reward sums are atomics, updated without locks.
+ * - Virtual loss: a thread that selects action a immediately counts the visit and subtracts virtualLoss from the reward sum of a, so that the other threads prefer different paths while its simulation is running.  The backup adds the return plus virtualLoss.
+ * - Lazy expansion is lock-free: the first thread to reach an unexpanded node claims it (Unexpanded -> Expanding), creates its successors and publishes them (Expanding -> Expanded).  A thread that finds a node being expanded treats it as a leaf instead of waiting.
+ * Successors are stored in fixed arrays (expandMDP returns at most MaxOutcomes states per action), so publishing them only takes the store of status.
+ */
+
+#ifndef SHAREDTREE_H
+#define SHAREDTREE_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include "maze.h"
+
+using std::vector;
+
+class SharedNode{
+    public:
+        static const int MaxActions = 4;
+        static const int MaxOutcomes = 2; //Trapped or not
+
+    private:
+        enum { Unexpanded, Expanding, Expanded };
+
+        int32_t cell; //Maze cell (row*cols + col)
+        std::atomic<int> count; //Times the node has been visited
+        std::atomic<int> actionCount[MaxActions]; //No. of times each action has been executed
+        std::atomic<double> reward[MaxActions]; //Sum of rewards of each action
+        std::atomic<int> status;
+        SharedNode * successors[MaxActions][MaxOutcomes];
+        uint8_t numSuccessors[MaxActions];
+
+        static void AtomicAdd(std::atomic<double>& x, double r);
+
+    public:
+        SharedNode(int cell);
+        ~SharedNode();
+
+        bool expanded() const { return status.load(std::memory_order_acquire) == Expanded; }
+        bool Expand(const Maze * MDP); //Create all successors, if no other thread has.  Returns false if the node is or was being expanded by another thread
+        bool ClaimLeaf(); //Count the first visit of an unvisited node.  Returns false if the node has been visited (by another thread)
+
+        int getCount() const { return count.load(std::memory_order_relaxed); }
+        int getActionCount(int a) const { return actionCount[a].load(std::memory_order_relaxed); }
+        double getValue(int a) const; //Compute Q(s,a)
+        void AddVirtualLoss(int a, double loss); //Count a visit of (s,a) before its return is known
+        void Update(int a, double r, double loss); //Add the return of (s,a) and remove the virtual loss
+
+        SharedNode * getSuccessor(int a, const State& s, int cols) const; //Successor of action a that matches state s
+        SharedNode * freeSuccessor(int a, const State& s, int cols); //Release the successor that matches s, so that it is not deleted with this node
+        State getState(int cols) const { return State(cell / cols, cell % cols); }
+
+        long getNumNodes() const; //No. of nodes in the subtree
+        size_t getMemory() const; //Bytes allocated by the subtree
+        bool Validate() const; //Check that no updates were lost in the subtree (only when no thread is searching)
+};
+
+inline void SharedNode::AtomicAdd(std::atomic<double>& x, double r){
+    double old = x.load(std::memory_order_relaxed);
+    while(!x.compare_exchange_weak(old, old + r, std::memory_order_relaxed));
+}
+
+inline double SharedNode::getValue(int a) const{
+    int n_ = getActionCount(a);
+    double r = reward[a].load(std::memory_order_relaxed);
+    return n_ ? r / n_ : r;
+}
+
+inline void SharedNode::AddVirtualLoss(int a, double loss){
+    count.fetch_add(1, std::memory_order_relaxed);
+    actionCount[a].fetch_add(1, std::memory_order_relaxed);
+    AtomicAdd(reward[a], -loss);
+}
+
+inline void SharedNode::Update(int a, double r, double loss){
+    AtomicAdd(reward[a], r + loss);
+}
+
+inline bool SharedNode::ClaimLeaf(){
+    int unvisited = 0;
+    return count.compare_exchange_strong(unvisited, 1, std::memory_order_relaxed);
+}
+
+inline SharedNode * SharedNode::getSuccessor(int a, const State& s, int cols) const{
+    assert(expanded() && a >= 0 && a < MaxActions);
+    int target = s.row * cols + s.col;
+    SharedNode * next = 0;
+    for(int i=0; i < numSuccessors[a]; i++)
+        if(successors[a][i] && successors[a][i]->cell == target) next = successors[a][i];
+    return next;
+}
+
+#endif
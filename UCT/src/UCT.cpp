@@ -15,9 +15,11 @@ Node::Node(const State& s, vector<int> actions){
 Node::~Node(){
     for(vector<Node*>* s_ : successors){
         for(Node* n_ : *(s_)){
-            delete n_;
+            delete n_; //Successors released by freeSuccessor are NULL
         }
+        delete s_;
     }
+    delete s;
     reward.clear();
     successors.clear();
     actionCount.clear();
@@ -33,16 +35,30 @@ void Node::setSuccessors(vector< vector<Node*> *> successors){
     successors = successors;
 }
 
+/*
+ * Release the successor that matches state s, so that it is not deleted with this node
+ */
 void Node::freeSuccessor(int action, State& s){    
     assert(action >= 0 && action < successors.size());    
-    vector<Node *> sucs = *(successors[action]);
-    for(Node* n_ : sucs){
-        if(s.equals(n_->getState())){
+    for(Node*& n_ : *(successors[action])){
+        if(n_ && s.equals(n_->getState())){
             n_ = NULL; //free pointer
         }
     }
 }
 
+/*
+ * Move all successors to nodes and release them, so that this node can be deleted without its subtree
+ */
+void Node::detachSuccessors(vector<Node*>& nodes){
+    for(vector<Node*>* s_ : successors){
+        for(Node* n_ : *(s_))
+            if(n_) nodes.push_back(n_);
+        delete s_;
+    }
+    successors.clear();
+}
+
 bool Node::expanded(){
     return successors.size() > 0;
 }
@@ -58,7 +74,7 @@ Node* Node::getSuccessor(int action, State& s){
     Node * next = 0;
 
     for(Node* n_ : *(successors[action])){        
-        if(s.equals(n_->getState())){
+        if(n_ && s.equals(n_->getState())){
             next = n_;
         }
     }
@@ -106,6 +122,25 @@ State& Node::getState(){
     return *s;
 }
 
+long Node::getNumNodes(){
+    long nodes = 1;
+    for(vector<Node*>* s_ : successors)
+        for(Node* n_ : *(s_))
+            if(n_) nodes += n_->getNumNodes();
+    return nodes;
+}
+
+size_t Node::getMemory(){
+    size_t bytes = sizeof(Node) + sizeof(State) + actions.capacity()*sizeof(int) + actionCount.capacity()*sizeof(int)
+                 + reward.capacity()*sizeof(double) + successors.capacity()*sizeof(vector<Node*>*);
+    for(vector<Node*>* s_ : successors){
+        bytes += sizeof(vector<Node*>) + s_->capacity()*sizeof(Node*);
+        for(Node* n_ : *(s_))
+            if(n_) bytes += n_->getMemory();
+    }
+    return bytes;
+}
+
 //// End Class NODE ////
 
 //// Start Class UCT ////
@@ -116,15 +151,60 @@ UCT::UCT(UCT_PARAMS& searchParams, EXP_PARAMS& expParams, Maze * maze){
     
     this->searchParams.startstate = searchParams.startstate;
     this->searchParams.goalstate = searchParams.goalstate;
+    this->searchParams.tree = searchParams.tree;
+    this->searchParams.threads = std::max(1, searchParams.threads);
+    this->searchParams.parallel = searchParams.parallel;
+    this->searchParams.virtualLoss = searchParams.virtualLoss;
+    this->searchParams.rollouts = std::max(1, searchParams.rollouts);
+    rootParallel = (this->searchParams.parallel == "root" && this->searchParams.threads > 1);
+    treeParallel = (this->searchParams.parallel == "tree" && this->searchParams.threads > 1);
+    leafParallel = (this->searchParams.parallel == "leaf" && this->searchParams.threads > 1);
     
     this->expParams.minSims = expParams.minSims;
     this->expParams.maxSims = expParams.maxSims;
     this->expParams.numSteps = expParams.numSteps;
     this->expParams.numRuns = expParams.numRuns;
     this->expParams.verbose = expParams.verbose;
+    this->expParams.exact = expParams.exact;
+    this->expParams.exactThreads = expParams.exactThreads;
     this->expParams.outputFile = expParams.outputFile;
     
     this->MDP = maze;    
+    rolloutPolicy = 0;
+    Tree = new FlatTree(maze, this->searchParams.tree == "dag");
+    Spare = new FlatTree(maze, this->searchParams.tree == "dag");
+    
+    //One searcher per thread, each with its own random numbers.  With a single thread the search uses rand() as before
+    rng = 0;
+    pool = 0;
+    SharedRoot = 0;
+    leafCount = 0;
+    leafSum = leafSumSquares = 0.0;
+    partialSums.resize(this->searchParams.threads);
+    if(this->searchParams.threads > 1){
+        UCT_PARAMS workerParams = searchParams;
+        EXP_PARAMS workerExpParams = expParams;
+        workerParams.threads = 1;
+        workerExpParams.verbose = 0;
+        for(int i=1; i < this->searchParams.threads; i++){
+            UCT * w = new UCT(workerParams, workerExpParams, maze);
+            w->generator.seed(i);
+            w->rng = &w->generator;
+            workers.push_back(w);
+        }
+        generator.seed(0);
+        rng = &generator;
+        pool = new ThreadPool(this->searchParams.threads);
+    }
+}
+
+UCT::~UCT(){
+    delete Tree;
+    delete Spare;
+    for(UCT * w : workers)
+        delete w;
+    delete pool;
+    delete SharedRoot;
 }
 
 /*
@@ -157,7 +237,7 @@ int UCT::UCB(Node * n, bool greedy){
 
     }
 
-    int best = rand() % bestA.size();
+    int best = Random(bestA.size());
 
     int action = bestA[best];
     bestA.clear();
@@ -176,6 +256,7 @@ int UCT::Search(Node * n, int nsims){
     for(int i=0; i < nsims; i++){        
         r = Simulate(s, n, searchParams.depth);
         s.copy(n->getState());
+        Reclaim(ReclaimRate); //The old tree is deleted a few nodes at a time, instead of all at once
     }
     
     return UCB(n, true);
@@ -194,7 +275,7 @@ double UCT::Simulate(State& s, Node* n, int depth){
     int action;
     
     action = UCB(n); //Get action using UCB.  Untried actions are preferred through exploration bias.
-    terminal = MDP->Step(s, action, reward); //Simulate step with given action
+    terminal = MDP->Step(s, action, reward, rng); //Simulate step with given action
     
     if(!n->expanded()){        
         expandNode(n); //Newly visited nodes get all successors added at once
@@ -205,13 +286,10 @@ double UCT::Simulate(State& s, Node* n, int depth){
         
         //If node has not been visited
         if(next->getCount() == 0){            
-            State * nextState = new State(next->getState());
-            
             //Perform MCTS Rollout
-            delayedReward = Rollout(*nextState, depth-1);
+            delayedReward = LeafRollouts(next->getState(), depth-1);
             
             next->increaseCount();
-            delete nextState;
         }
         else{
             //Continue search if state is not terminal and has been visited
@@ -240,8 +318,8 @@ double UCT::Rollout(State& s, int depth){
     int action;
     
     for(int i=depth; i > 0 && !terminal; i--){
-        action = MDP->SelectRandom(s); //Select action using RO policy
-        terminal = MDP->Step(s, action, reward); //Simulate step in MDP
+        action = rolloutPolicy ? rolloutPolicy->getAction(s.row, s.col) : MDP->SelectRandom(s, rng); //Select action using RO policy
+        terminal = MDP->Step(s, action, reward, rng); //Simulate step in MDP
         
         totalReward += reward * discount; //Compute discounted return
         discount *= searchParams.discount;
@@ -253,6 +331,230 @@ double UCT::Rollout(State& s, int depth){
     return totalReward;
 }
 
+/*
+ * Leaf parallelization: the value of a new leaf is the mean of B independent rollouts, which reduces its variance by a factor B.
+ * With --parallel leaf the threads of the pool share the rollouts (rollout i runs on thread i % threads), otherwise they run one after another.  A single rollout makes the same calls to rand as before.
+ */
+double UCT::LeafRollouts(const State& s, int depth){
+    int B = searchParams.rollouts;
+    double value = 0.0;
+    
+    if(leafParallel && B > 1){
+        pool->Run([&](int id){
+            UCT * w = id ? workers[id-1] : this;
+            partialSums[id] = 0.0;
+            for(int i=id; i < B; i += searchParams.threads){
+                State rolloutState(s);
+                partialSums[id] += w->Rollout(rolloutState, depth);
+            }
+        });
+        for(double sum : partialSums)
+            value += sum;
+    }
+    else{
+        for(int i=0; i < B; i++){
+            State rolloutState(s);
+            value += Rollout(rolloutState, depth);
+        }
+    }
+    value /= B;
+    
+    leafCount++;
+    leafSum += value;
+    leafSumSquares += value * value;
+    return value;
+}
+
+/*
+ * UCB1 on the flat tree.  Same rule (and calls to rand) as UCB
+ */
+int UCT::UCBFlat(uint32_t n, bool greedy){
+    int bestA[4]; //At most 4 actions
+    int numBest = 0;
+    double bestQ = -Infinity;
+    State s = Tree->getState(n);
+    
+    legalActions.clear(); //Keeps its memory, so there are no allocations per call
+    MDP->getLegalActions(s, legalActions);
+    
+    for(int a : legalActions){
+        double q = Tree->getValue(n, a);
+        
+        if(!greedy){
+            int N_ = Tree->getCount(n);
+            int n_ = Tree->getActionCount(n, a);
+            if(n_ == 0)
+                q += Infinity; //Prefer untried actions
+            else
+                q += searchParams.exploration * std::sqrt(std::log(N_ + 1) / n_);
+        }
+        
+        if (q >= bestQ){
+            if (q > bestQ) numBest = 0;
+            bestQ = q;
+            bestA[numBest++] = a;
+        }
+    }
+    
+    return bestA[Random(numBest)];
+}
+
+int UCT::SearchFlat(uint32_t n, int nsims){
+    State s = Tree->getState(n);
+    for(int i=0; i < nsims; i++){
+        SimulateFlat(s, n, searchParams.depth);
+        s = Tree->getState(n);
+    }
+    
+    return UCBFlat(n, true);
+}
+
+/*
+ * Same as Simulate.  Nodes are expanded before UCB, which makes no difference since unexpanded nodes have no statistics.
+ * Returns the value that the parent backs up: the sampled return, or with transpositions the value of n
+ */
+double UCT::SimulateFlat(State& s, uint32_t n, int depth){
+    if(!depth) return 0;
+    
+    double reward = 0.0;
+    double delayedReward = 0.0;
+    
+    if(!Tree->expanded(n))
+        Tree->Expand(n); //Newly visited nodes get all successors added at once
+    
+    int action = UCBFlat(n);
+    bool terminal = MDP->Step(s, action, reward, rng);
+    
+    if(!terminal){
+        uint32_t next = Tree->getSuccessor(n, action, s);
+        
+        if(Tree->getCount(next) == 0){
+            delayedReward = LeafRollouts(s, depth-1);
+            Tree->increaseCount(next);
+        }
+        else
+            delayedReward = SimulateFlat(s, next, depth-1);
+    }
+    
+    double totalReward = reward + searchParams.discount*delayedReward;
+    Tree->Update(n, action, totalReward);
+    
+    //With transpositions the parent backs up the value of n, which includes the visits from all other paths (see FlatTree.h)
+    if(Tree->hasTranspositions())
+        return Tree->getNodeValue(n);
+    return totalReward;
+}
+
+/*
+ * UCB1 on a shared node.  The counts and values include the virtual losses of the simulations in progress
+ */
+int UCT::UCBShared(SharedNode * n, bool greedy){
+    int bestA[4]; //At most 4 actions
+    int numBest = 0;
+    double bestQ = -Infinity;
+    State s = n->getState(MDP->getCols());
+    
+    legalActions.clear();
+    MDP->getLegalActions(s, legalActions);
+    
+    int N_ = n->getCount();
+    for(int a : legalActions){
+        double q = n->getValue(a);
+        
+        if(!greedy){
+            int n_ = n->getActionCount(a);
+            if(n_ == 0)
+                q += Infinity; //Prefer untried actions
+            else
+                q += searchParams.exploration * std::sqrt(std::log(N_ + 1) / n_);
+        }
+        
+        if (q >= bestQ){
+            if (q > bestQ) numBest = 0;
+            bestQ = q;
+            bestA[numBest++] = a;
+        }
+    }
+    
+    return bestA[Random(numBest)];
+}
+
+/*
+ * Same as SimulateFlat, called by several threads on the same tree.
+ * The visit of (s,a) is counted with a virtual loss before the step, so that the other threads see it while this simulation is running, and the backup replaces the virtual loss by the return.
+ */
+double UCT::SimulateShared(State& s, SharedNode * n, int depth){
+    if(!depth) return 0;
+    
+    double reward = 0.0;
+    double delayedReward = 0.0;
+    
+    //If another thread is expanding n, n is a leaf for this simulation
+    if(!n->expanded() && !n->Expand(MDP))
+        return LeafRollouts(s, depth);
+    
+    int action = UCBShared(n);
+    n->AddVirtualLoss(action, searchParams.virtualLoss);
+    bool terminal = MDP->Step(s, action, reward, rng);
+    
+    if(!terminal){
+        SharedNode * next = n->getSuccessor(action, s, MDP->getCols());
+        
+        //Only one thread gets to count the first visit, and the others continue the search below next
+        if(next->getCount() == 0 && next->ClaimLeaf())
+            delayedReward = LeafRollouts(s, depth-1);
+        else
+            delayedReward = SimulateShared(s, next, depth-1);
+    }
+    
+    double totalReward = reward + searchParams.discount*delayedReward;
+    n->Update(action, totalReward, searchParams.virtualLoss);
+    
+    return totalReward;
+}
+
+/*
+ * The threads take simulations from a common counter until nsims have started
+ */
+int UCT::SearchShared(SharedNode * n, int nsims){
+    std::atomic<int> started(0);
+    pool->Run([&](int id){
+        UCT * w = id ? workers[id-1] : this;
+        State root = n->getState(MDP->getCols());
+        State s(root);
+        while(started.fetch_add(1, std::memory_order_relaxed) < nsims){
+            w->SimulateShared(s, n, searchParams.depth);
+            s = root;
+        }
+    });
+    
+    return UCBShared(n, true);
+}
+
+bool UCT::setRolloutPolicy(const PolicyFile * policy){
+    if(policy->getRows() != MDP->getRows() || policy->getCols() != MDP->getCols()){
+        std::cerr << "Policy is " << policy->getRows() << "x" << policy->getCols() << " but the maze is "
+                  << MDP->getRows() << "x" << MDP->getCols() << "." << endl;
+        return false;
+    }
+    rolloutPolicy = policy;
+    for(UCT * w : workers)
+        w->rolloutPolicy = policy;
+    return true;
+}
+
+/*
+ * Nodes are deleted one at a time, after their successors are moved to garbage
+ */
+void UCT::Reclaim(int maxNodes){
+    for(int i=0; i < maxNodes && !garbage.empty(); i++){
+        Node * m = garbage.back();
+        garbage.pop_back();
+        m->detachSuccessors(garbage);
+        delete m;
+    }
+}
+
 /* 
  * Create and add all successors of node n
  */
@@ -290,6 +592,116 @@ void UCT::expandNode(Node * n){
 
 }
 
+void UCT::NewRoot(State& s){
+    if(treeParallel){
+        delete SharedRoot;
+        SharedRoot = new SharedNode(s.row * MDP->getCols() + s.col);
+        SharedRoot->Expand(MDP);
+    }
+    else if(searchParams.tree != "node"){
+        Tree->Reset();
+        RootId = Tree->AddNode(s);
+        Tree->Expand(RootId);
+    }
+    else{
+        vector<int> actions;
+        MDP->getActions(s, actions);
+        Root = new Node(s, actions);
+        expandNode(Root);
+    }
+}
+
+int UCT::SearchRoot(int nsims){
+    if(treeParallel)
+        return SearchShared(SharedRoot, nsims * searchParams.threads); //Same budget as root parallelization
+    return searchParams.tree != "node" ? SearchFlat(RootId, nsims) : Search(Root, nsims);
+}
+
+/*
+ * The node of the new state becomes the root, so its visits count towards the next search, and the rest of the tree is reclaimed:
+ * - Node: the old root is queued in garbage and deleted by the next Search, ReclaimRate nodes per simulation.
+ * - Flat: the new subtree is copied to Spare and the old tree is reset, in O(1).
+ * - DAG: any node can be reached again from the new root, so the graph is kept.
+ * - Shared: the old tree is deleted between the searches, when no other thread is using it.
+ */
+int UCT::Advance(int action, State& s){
+    if(treeParallel){
+        SharedNode * m = SharedRoot->freeSuccessor(action, s, MDP->getCols());
+        delete SharedRoot;
+        SharedRoot = m;
+        return SharedRoot->getCount();
+    }
+    if(searchParams.tree != "node"){
+        RootId = Tree->getSuccessor(RootId, action, s);
+        if(!Tree->hasTranspositions()){
+            RootId = Tree->CopySubtree(RootId, *Spare);
+            std::swap(Tree, Spare);
+            Spare->Reset();
+        }
+        return Tree->getCount(RootId);
+    }
+    
+    Node * m = Root->getSuccessor(action, s);
+    Root->freeSuccessor(action, s); //Eliminate successor from list
+    garbage.push_back(Root);
+    Root = m; //continue planning with new node
+    return Root->getCount();
+}
+
+double UCT::DeleteTree(){
+    if(treeParallel){
+        double memory = SharedRoot->getMemory() / 1024.0;
+        delete SharedRoot;
+        SharedRoot = 0;
+        return memory;
+    }
+    if(searchParams.tree != "node")
+        return Tree->getUsedMemory() / 1024.0; //The flat tree is reset by the next run
+    
+    double memory = Root->getMemory() / 1024.0;
+    delete Root; //Tree is deleted after each run.  No need to delete in destructor
+    Reclaim(INT_MAX); //Old nodes that the last search did not get to
+    return memory;
+}
+
+/*
+ * Q(s,a) of the merged root is the mean return of a over the simulations of all searchers, i.e. the Q values of the roots weighted by their action counts.
+ * The action is then selected as in UCB(n, true).
+ */
+int UCT::MergeRoots(){
+    bool flat = (searchParams.tree != "node");
+    State s = flat ? Tree->getState(RootId) : Root->getState();
+    int bestA[4]; //At most 4 actions
+    int numBest = 0;
+    double bestQ = -Infinity;
+    
+    legalActions.clear();
+    MDP->getLegalActions(s, legalActions);
+    for(int a : legalActions){
+        double sum = 0.0;
+        long count = 0;
+        for(int i=0; i <= workers.size(); i++){
+            UCT * w = i ? workers[i-1] : this;
+            int n_ = flat ? w->Tree->getActionCount(w->RootId, a) : w->Root->getActionCount(a);
+            sum += n_ * (flat ? w->Tree->getValue(w->RootId, a) : w->Root->getValue(a));
+            count += n_;
+        }
+        double q = count ? sum / count : 0.0;
+        
+        if (q >= bestQ){
+            if (q > bestQ) numBest = 0;
+            bestQ = q;
+            bestA[numBest++] = a;
+        }
+    }
+    
+    return bestA[Random(numBest)];
+}
+
+int UCT::Random(int n){
+    return (rng ? (*rng)() : rand()) % n;
+}
+
 //// End Class UCT ////
 
 /// Execution functions ///
@@ -303,26 +715,49 @@ void UCT::Run(){
     double discountedReturn = 0.0;
     double discount = 1.0;
     bool terminal = false;    
+    long reused = 0; //Visits of the new roots before their search
+    long visits = 0; //Visits of the new roots after their search
+    double searchTime = 0.0; //ms
+    long numSims = 0;
+    
+    //Searcher i runs on thread i and has its own tree with root parallelization
+    vector<UCT*> searchers(1, this);
+    if(rootParallel)
+        searchers.insert(searchers.end(), workers.begin(), workers.end());
+    long budget = (leafParallel ? 1 : searchParams.threads) * (long)expParams.sims; //Simulations per step, over all threads
+    
+    leafCount = 0;
+    leafSum = leafSumSquares = 0.0;
+    for(UCT * w : workers){
+        w->leafCount = 0;
+        w->leafSum = w->leafSumSquares = 0.0;
+    }
+    vector<int> inherited(searchers.size());
+    
+    //Create tree roots
+    for(UCT * w : searchers)
+        w->NewRoot(*(searchParams.startstate));
         
-    vector<int> actions;
-    MDP->getActions(*(searchParams.startstate), actions);
-
-    //Create tree root
-    Root = new Node(*(searchParams.startstate), actions);
-    actions.clear();
-    expandNode(Root);
-        
-    Node * n = Root;
-    State& s(n->getState());
+    State s(*(searchParams.startstate));
     int t;
     
     for(t=0; t < expParams.numSteps && !terminal; t++){
         
         if(expParams.verbose >= 2)
-            cout << "Searching from root = " << n->getState() << ", count = " << n->getCount() << endl;
+            cout << "Searching from root = " << s << ", count = " << (treeParallel ? SharedRoot->getCount() : searchParams.tree != "node" ? Tree->getCount(RootId) : Root->getCount()) << endl;
                 
         double reward;        
-        int action = Search(n, expParams.sims);        
+        int action;
+        auto start = std::chrono::high_resolution_clock::now();
+        if(searchers.size() == 1)
+            action = SearchRoot(expParams.sims);
+        else{
+            pool->Run([&](int id){ searchers[id]->SearchRoot(expParams.sims); });
+            action = MergeRoots();
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        searchTime += std::chrono::duration<double, std::milli>(stop - start).count();
+        numSims += budget;
                 
         terminal = MDP->Step(s, action, reward); //Simulate step with action               
         
@@ -342,34 +777,43 @@ void UCT::Run(){
             cout << endl;
         }
         
-        n = n->getSuccessor(action, s); //Transition to new node
-        s.copy(n->getState()); //Update "world" state
-        
-        /*
+        //Transition to new node
         if(!terminal){
-            Node * m = n->getSuccessor(action, s);
-            n->freeSuccessor(action, s); //Eliminate successor from list
-            cout << "Freed" << endl;
-            delete n; //Delete old tree
-            cout << "Deleted old root" << endl;
-            n = m; //continue planning with new node
-            
-            cout << "New root = " << n->getState() << endl;
+            if(searchers.size() == 1)
+                inherited[0] = Advance(action, s);
+            else
+                pool->Run([&](int id){ inherited[id] = searchers[id]->Advance(action, s); });
             
-            if(!n->expanded()){                
-                expandNode(n); //Newly visited nodes get all successors added at once
-                cout << "Expanded root" << endl;
+            if(t+1 < expParams.numSteps){
+                for(int v : inherited){
+                    reused += v;
+                    visits += v + budget / searchers.size();
+                }
             }
-            cout << "Updating s" << endl;
-            s.copy(n->getState());
-            cout << "S: " << s << endl;
-        }*/
+            if(expParams.verbose >= 2)
+                cout << "New root = " << s << " with " << inherited[0] << " inherited visits" << endl;
+        }
         
         if(expParams.verbose >= 2)
             cout << "Step " << t <<" finished" << endl;
     }
     
-    delete Root; //Tree is deleted after each run.  No need to delete in destructor
+    double memory = 0.0;
+    for(UCT * w : searchers)
+        memory += w->DeleteTree();
+    results.memory.push_back(memory);
+    results.reuse.push_back(visits ? 100.0 * reused / visits : 0.0);
+    results.simsPerSec.push_back(searchTime > 0 ? numSims / searchTime * 1000 : 0.0);
+    
+    //Leaves of all threads
+    long leaves = leafCount;
+    double sum = leafSum, sumSquares = leafSumSquares;
+    for(UCT * w : workers){
+        leaves += w->leafCount;
+        sum += w->leafSum;
+        sumSquares += w->leafSumSquares;
+    }
+    results.leafVariance.push_back(leaves ? sumSquares / leaves - (sum / leaves) * (sum / leaves) : 0.0);
     
     results.discountedReturn.push_back(discountedReturn);
     results.undiscountedReturn.push_back(undiscountedReturn);
@@ -410,7 +854,30 @@ void UCT::Experiment(){
         std::cerr << "Error opening file \"" << expParams.outputFile << "\"" << endl;
 
     outputFile << "\t\tUndiscounted\tDiscounted" << endl;
-    outputFile << "Sims\tRuns\tReturn\tError\tReturn\tError\tTime" << endl;
+    outputFile << "Sims\tRuns\tReturn\tError\tReturn\tError\tTime\tKB\tReuse\tSims/s\tLeafVar" << endl;
+    
+    //Ground truth for the sampled returns below: optimal values of episodes with numSteps steps
+    if(expParams.exact){
+        BackwardInduction exact(MDP, *(searchParams.goalstate), searchParams.discount, expParams.exactThreads);
+        exact.Solve(expParams.numSteps);
+        State& s0 = *(searchParams.startstate);
+        
+        cout << "Exact (backward induction, " << expParams.numSteps << " steps, " << exact.getTime() << " ms): disc. return = " << exact.getDiscountedReturn(s0)
+             << ", undisc. return = " << exact.getUndiscountedReturn(s0) << " (max. undisc. return = " << exact.getOptimalUndiscountedReturn(s0) << ")" << endl;
+        
+        outputFile  << "Exact\t"
+                    << 0 << "\t"
+                    << std::setprecision(4) << exact.getUndiscountedReturn(s0) << "\t"
+                    << 0 << "\t"
+                    << std::setprecision(4) << exact.getDiscountedReturn(s0) << "\t"
+                    << 0 << "\t"
+                    << std::setprecision(4) << exact.getTime() / 1000 << "\t"
+                    << 0 << "\t"
+                    << 0 << "\t"
+                    << 0 << "\t"
+                    << 0 << "\t"
+                    << endl;
+    }
     
     for(int i=expParams.minSims; i <= expParams.maxSims; i++){
         expParams.sims = 1 << i; //2^i simulations
@@ -426,9 +893,17 @@ void UCT::Experiment(){
         undiscStdErr = STATISTIC::stdError(results.undiscountedReturn);
         
         meanTime = STATISTIC::mean(results.time) / 1000;
+        double meanMemory = STATISTIC::mean(results.memory);
+        double meanReuse = STATISTIC::mean(results.reuse);
+        double meanSimsPerSec = STATISTIC::mean(results.simsPerSec);
+        double meanLeafVariance = STATISTIC::mean(results.leafVariance);
         
         cout << "Mean disc. return = " << discMean << " +- " << discStdErr << endl;    
         cout << "Mean undisc. return = " << undiscMean << " +- " << undiscStdErr << endl;
+        cout << "Mean tree size = " << meanMemory << " KB" << endl;
+        cout << "Mean inherited visits = " << meanReuse << "% of the root visits" << endl;
+        cout << "Mean simulations per second = " << meanSimsPerSec << " (" << searchParams.threads << " threads)" << endl;
+        cout << "Mean leaf variance = " << meanLeafVariance << " (" << searchParams.rollouts << " rollouts per leaf)" << endl;
         
         outputFile  << expParams.sims << "\t"
                     << expParams.numRuns << "\t"
@@ -437,6 +912,10 @@ void UCT::Experiment(){
                     << std::setprecision(4) << discMean << "\t"
                     << std::setprecision(4) << discStdErr << "\t"
                     << std::setprecision(4) << meanTime << "\t"
+                    << std::setprecision(4) << meanMemory << "\t"
+                    << std::setprecision(4) << meanReuse << "\t"
+                    << std::setprecision(4) << meanSimsPerSec << "\t"
+                    << std::setprecision(4) << meanLeafVariance << "\t"
                     << endl;
                     
         results.clear();
@@ -473,3 +952,86 @@ void UCT::Solve(){
     cout << "Deterministic policy generated with " << nSims << " simulations per step:" << endl;
     MDP->DisplayPolicy(states, bestActions, cout);
 }
+
+/*
+ * Search from the start state with 2^maxSims simulations, once on Node objects and once on the flat tree.
+ * Both searches start from the same random seed and make the same calls to rand, so they must build the same tree and pick the same action (unless the flat tree uses transpositions).
+ */
+void UCT::Benchmark(){
+    int nSims = 1 << expParams.maxSims;
+    State start(*(searchParams.startstate));
+    vector<int> actions;
+    MDP->getActions(start, actions);
+    
+    //Node objects
+    srand(0);
+    generator.seed(0); //Used instead of rand() with several threads
+    auto t0 = std::chrono::high_resolution_clock::now();
+    Root = new Node(start, actions);
+    expandNode(Root);
+    int nodeAction = Search(Root, nSims);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    long nodeNodes = Root->getNumNodes();
+    size_t nodeBytes = Root->getMemory();
+    int nodeCount = Root->getCount();
+    auto t2 = std::chrono::high_resolution_clock::now();
+    delete Root;
+    auto t3 = std::chrono::high_resolution_clock::now();
+    double nodeTime = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double nodeFree = std::chrono::duration<double, std::milli>(t3 - t2).count();
+    
+    //Flat tree
+    srand(0);
+    generator.seed(0); //Used instead of rand() with several threads
+    t0 = std::chrono::high_resolution_clock::now();
+    Tree->Reset();
+    uint32_t root = Tree->AddNode(start);
+    Tree->Expand(root);
+    int flatAction = SearchFlat(root, nSims);
+    t1 = std::chrono::high_resolution_clock::now();
+    long flatNodes = Tree->getNumNodes();
+    size_t flatBytes = Tree->getMemory();
+    int flatCount = Tree->getCount(root);
+    t2 = std::chrono::high_resolution_clock::now();
+    Tree->Reset();
+    t3 = std::chrono::high_resolution_clock::now();
+    double flatTime = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double flatFree = std::chrono::duration<double, std::milli>(t3 - t2).count();
+    
+    cout << "Search from " << start << " with " << nSims << " simulations:" << endl;
+    cout << std::setw(8) << "" << std::setw(12) << "Time (ms)" << std::setw(14) << "Sims/sec" << std::setw(12) << "Nodes" << std::setw(14) << "Nodes/sec"
+         << std::setw(12) << "Bytes/node" << std::setw(14) << "Free (ms)" << endl;
+    cout << std::setw(8) << "Node" << std::setw(12) << nodeTime << std::setw(14) << nSims / nodeTime * 1000 << std::setw(12) << nodeNodes << std::setw(14) << nodeNodes / nodeTime * 1000
+         << std::setw(12) << (double)nodeBytes / nodeNodes << std::setw(14) << nodeFree << endl;
+    cout << std::setw(8) << (Tree->hasTranspositions() ? "DAG" : "Flat") << std::setw(12) << flatTime << std::setw(14) << nSims / flatTime * 1000 << std::setw(12) << flatNodes << std::setw(14) << flatNodes / flatTime * 1000
+         << std::setw(12) << (double)flatBytes / flatNodes << std::setw(14) << flatFree << endl;
+    cout << "Speedup = " << nodeTime / flatTime;
+    if(!Tree->hasTranspositions())
+        cout << ", same tree: " << (nodeNodes == flatNodes && nodeCount == flatCount && nodeAction == flatAction ? "yes" : "NO");
+    cout << endl;
+    
+    /*
+     * Tree parallelization, with the same no. of simulations spread over all threads.
+     * After the search, every simulation must have been counted exactly once at the root, and the counts of every node must match the counts of its actions (no lost updates)
+     */
+    if(treeParallel){
+        t0 = std::chrono::high_resolution_clock::now();
+        NewRoot(start);
+        int sharedAction = SearchShared(SharedRoot, nSims);
+        t1 = std::chrono::high_resolution_clock::now();
+        long sharedNodes = SharedRoot->getNumNodes();
+        size_t sharedBytes = SharedRoot->getMemory();
+        bool consistent = (SharedRoot->getCount() == nSims && SharedRoot->Validate());
+        t2 = std::chrono::high_resolution_clock::now();
+        delete SharedRoot;
+        SharedRoot = 0;
+        t3 = std::chrono::high_resolution_clock::now();
+        double sharedTime = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double sharedFree = std::chrono::duration<double, std::milli>(t3 - t2).count();
+        
+        cout << std::setw(8) << "Shared" << std::setw(12) << sharedTime << std::setw(14) << nSims / sharedTime * 1000 << std::setw(12) << sharedNodes << std::setw(14) << sharedNodes / sharedTime * 1000
+             << std::setw(12) << (double)sharedBytes / sharedNodes << std::setw(14) << sharedFree << endl;
+        cout << "Speedup over " << (Tree->hasTranspositions() ? "DAG" : "Flat") << " = " << flatTime / sharedTime << " with " << searchParams.threads << " threads, consistent counts: " << (consistent ? "yes" : "NO")
+             << ", action: " << sharedAction << " (single thread: " << flatAction << ")" << endl;
+    }
+}
@@ -11,16 +11,27 @@
 
 #define Infinity 1e+10
 #define DiscountDepth -4.6052 //log(0.01)
+#define ReclaimRate 16 //Old nodes deleted per simulation, twice as many as one expansion creates
 
 #include <cassert>
 #include <vector>
 #include <cmath>
 #include <cstring>
+#include <climits>
+#include <utility>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <chrono>
+#include <random>
+#include <functional>
 #include "maze.h"
+#include "policyfile.h"
+#include "threadpool.h"
+#include "BackwardInduction.h"
+#include "FlatTree.h"
+#include "SharedTree.h"
 
 using std::vector;
 using std::cout;
@@ -55,8 +66,12 @@ class Node{
         vector< vector<Node*> *> * getSuccessorsVector();
         void setSuccessors(vector< vector<Node*> *> succesors);
         Node* getSuccessor(int action, State& s);
-        void freeSuccessor(int action, State& s);
+        void freeSuccessor(int action, State& s); //Release a successor from this node, e.g. to make it the new root
+        void detachSuccessors(vector<Node*>& nodes); //Release all successors and add them to nodes
         bool expanded();
+        
+        long getNumNodes(); //No. of nodes in the subtree
+        size_t getMemory(); //Bytes allocated by the subtree
 };
 
 //Search params
@@ -66,6 +81,11 @@ struct UCT_PARAMS{
     int depth;
     State* startstate;
     State* goalstate;
+    std::string tree = "flat"; //Tree representation: flat (FlatTree), dag (FlatTree with transpositions) or node (Node objects)
+    int threads = 1; //Parallel search with this many threads
+    std::string parallel = "root"; //root (one tree per thread, merged at the root), tree (all threads search one SharedNode tree) or leaf (the threads run the rollouts of every new leaf)
+    double virtualLoss = 10; //Tree parallelization: reward subtracted from the actions being simulated by other threads
+    int rollouts = 1; //Rollouts from every new leaf, whose mean is backed up
 };
 
 //Experiment params
@@ -77,6 +97,8 @@ struct EXP_PARAMS{
     int numRuns;
     std::string outputFile;
     int verbose = 1;
+    bool exact = false; //Add the exact optimal returns (backward induction) to the output
+    int exactThreads = 1;
 };
 
 //Store experiment results
@@ -85,6 +107,10 @@ struct RESULTS{
     vector<double> reward;
     vector<double> undiscountedReturn;
     vector<double> discountedReturn;
+    vector<double> memory; //KB used by the tree at the end of each run
+    vector<double> reuse; //Visits that the roots after the first step inherited from the previous search, in % of their visits after the search
+    vector<double> simsPerSec; //Simulations per second of search, over all threads
+    vector<double> leafVariance; //Variance of the values of new leaves (the means of their rollouts)
     
     void clear();
 };
@@ -95,26 +121,79 @@ inline void RESULTS::clear()
     reward.clear();
     discountedReturn.clear();
     undiscountedReturn.clear();	 
+    memory.clear();
+    reuse.clear();
+    simsPerSec.clear();
+    leafVariance.clear();
 }
 
 class UCT{
     private:
         Node * Root; //The root of the MCTS tree
+        FlatTree * Tree; //Arena tree, used instead of Root if searchParams.tree is "flat" or "dag"
+        uint32_t RootId; //The root of Tree
+        SharedNode * SharedRoot; //Tree parallelization: the tree of all threads
+        bool rootParallel, treeParallel, leafParallel;
+        
+        //Values of new leaves, for their variance
+        long leafCount;
+        double leafSum, leafSumSquares;
+        vector<double> partialSums; //Leaf parallelization: sum of the rollouts of each thread
+        FlatTree * Spare; //Receives the subtree of the new root after each step, then swapped with Tree
+        vector<Node*> garbage; //Nodes of old trees that have yet to be deleted
+        vector<int> legalActions; //Scratch space for UCBFlat
         UCT_PARAMS searchParams;
         EXP_PARAMS expParams;
         RESULTS results;
         Maze * MDP; //The planning domain
+        const PolicyFile * rolloutPolicy; //Rollout policy (random if not set)
+        
+        /*
+         * Parallel search: the other threads run their simulations with their own UCT objects (random numbers and scratch space).
+         * With root parallelization they also search their own trees, and the statistics of all roots are merged to select the action.  With tree parallelization they all search SharedRoot.
+         */
+        vector<UCT*> workers; //Searchers of threads 1...threads-1
+        ThreadPool * pool;
+        std::mt19937 generator;
+        std::mt19937 * rng; //Random numbers for this searcher, &generator with several threads or 0 to use rand()
                 
         void expandNode(Node * n); //Create node successors
+        void Reclaim(int maxNodes); //Delete up to maxNodes nodes from garbage
+        int Random(int n); //Random integer in 0...n-1
+        
+        /*
+         * Tree management for Run, on the representation selected by searchParams.tree
+         */
+        void NewRoot(State& s); //Create a tree with s at its root
+        int SearchRoot(int nsims); //Search from the root and return the greedy action
+        int Advance(int action, State& s); //Make the successor of action that matches s the new root, reclaim the rest of the tree, and return the visits of the new root
+        double DeleteTree(); //Delete the tree and return the KB it used
+        int MergeRoots(); //Greedy action for the combined root statistics of all searchers
     
     public:
         UCT(UCT_PARAMS& searchParams, EXP_PARAMS& expParams, Maze * maze);
-        //~UCT();
+        ~UCT();
         
         int Search(Node * n, int nsims); //Plan with UCT from node n, using nsims simulations
         int UCB(Node * n, bool greedy = false); //UCB action selection
         double Simulate(State& s, Node * n, int depth); //MCTS simulation
         double Rollout(State& s, int depth); //MCTS Rollout
+        double LeafRollouts(const State& s, int depth); //Mean of searchParams.rollouts rollouts from a new leaf
+        
+        /*
+         * The same search on the flat tree, node n is a FlatTree id
+         */
+        int SearchFlat(uint32_t n, int nsims);
+        int UCBFlat(uint32_t n, bool greedy = false);
+        double SimulateFlat(State& s, uint32_t n, int depth);
+        
+        /*
+         * The same search on a SharedNode tree, run by several threads at once
+         */
+        int SearchShared(SharedNode * n, int nsims); //Search from n with nsims simulations over all threads (needs threads > 1)
+        int UCBShared(SharedNode * n, bool greedy = false);
+        double SimulateShared(State& s, SharedNode * n, int depth);
+        bool setRolloutPolicy(const PolicyFile * policy); //Follow a policy computed by VI in rollouts.  Returns false if it does not match the maze
         
         /*
          * Execution and testing functions
@@ -127,6 +206,11 @@ class UCT{
          * Generate complete policy by iterating over all states
          */
         void Solve();
+        
+        /*
+         * Search from the start state with both tree representations and compare their speed and memory, and with tree parallelization if set
+         */
+        void Benchmark();
 };
 
 #endif
@@ -6,6 +6,7 @@
  */
 #include <iostream>
 #include <cstring>
+#include <chrono>
 #include "maze.h"
 #include "UCT.h"
 #include "ParserUCT.h"
@@ -33,6 +34,13 @@ int main(int argc, char ** argv){
     expParams.numSteps = cl.numSteps;
     expParams.outputFile = cl.outputFile;
     expParams.verbose = cl.verbose;
+    uctParams.tree = cl.tree;
+    uctParams.threads = cl.threads;
+    uctParams.parallel = cl.parallel;
+    uctParams.virtualLoss = cl.virtualLoss;
+    uctParams.rollouts = cl.rollouts;
+    expParams.exact = cl.exact >= 0;
+    expParams.exactThreads = cl.exact;
     
     //Create maze
     Maze * M = new Maze(mazeParams);    
@@ -42,11 +50,27 @@ int main(int argc, char ** argv){
     //Create UCT (planner)
     UCT uct(uctParams, expParams, M);
     
+    //Load the rollout policy
+    PolicyFile policy;
+    if(cl.policyFile != "none"){
+        auto start = std::chrono::high_resolution_clock::now();
+        if(!policy.Open(cl.policyFile) || !uct.setRolloutPolicy(&policy)){
+            std::cerr << "Could not load policy file." << endl;
+            return -1;
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        cout << "Loaded rollout policy (gamma = " << policy.getDiscount() << ", error = " << policy.getError() << ") in "
+             << std::chrono::duration<double, std::milli>(stop - start).count() << " ms." << endl;
+    }
+    
     /* Run UCT with specified parameters
      * Solve() generates and prints a deterministic policy (not useful in larger problems)
+     * Benchmark() compares the Node and flat trees (and the shared tree, with --parallel tree) on a single search
      * Experiment() runs UCT online several times following the conditions in expParameters, and generates an output file.
      */
-    if(cl.solve)
+    if(cl.benchmark)
+        uct.Benchmark();
+    else if(cl.solve)
         uct.Solve();
     else
         uct.Experiment();
@@ -2,7 +2,7 @@
 
 Maze::Maze(PARAMS& params){
     cols = params.cols;
-    rows = params.cols;
+    rows = params.rows;
     traps = params.traps;
     p_traps = params.p_traps;
     goalstate = params.goal;
@@ -145,14 +145,14 @@ void Maze::getLegalActions(State& s, vector<int>& actions) const{
  * 
  * Simulate the transition from state s and action a
  */
-bool Maze::Step(State& s, int action, double& reward) const{
+bool Maze::Step(State& s, int action, double& reward, std::mt19937 * rng) const{
     //Assume transition is not terminal
     bool terminal = false;        
     
     //Find out if agent landed on a trap
     if(grid[s.row][s.col] == trap){        
         //Simulate trap.  If true, agent remains trapped and cannot execute action.
-        if(Bernoulli(p_traps)){
+        if(Bernoulli(p_traps, rng)){
             reward = rTrap;
             return false; //Non-terminal state
         }
@@ -207,11 +207,11 @@ bool Maze::Step(State& s, int action, double& reward) const{
     return terminal;
 }
 
-int Maze::SelectRandom(State& s) const{
+int Maze::SelectRandom(State& s, std::mt19937 * rng) const{
     vector<int> actions;
     getLegalActions(s, actions);
     
-    int action = rand() % actions.size(); //Uniformly random action
+    int action = (rng ? (*rng)() : rand()) % actions.size(); //Uniformly random action
     actions.clear();
     return action;
 }
@@ -219,7 +219,8 @@ int Maze::SelectRandom(State& s) const{
 /*
  * Simulate a Bernoulli trial with a given probability
  */
-bool Maze::Bernoulli(double p) const{
+bool Maze::Bernoulli(double p, std::mt19937 * rng) const{
+    if(rng) return (*rng)() < p * rng->max();
     return rand() < p * RAND_MAX;
 }
 
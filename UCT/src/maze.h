@@ -16,6 +16,7 @@
 #include <vector>
 #include <cstdlib>
 #include <ctime>
+#include <random>
 
 using std::vector;
 
@@ -28,6 +29,7 @@ struct State{
     
     State(int r, int c){ row = r; col = c; }
     State(const State& s2){ row = s2.row; col = s2.col; }
+    State& operator=(const State& s2){ row = s2.row; col = s2.col; return *this; }
     bool equals(State s2){ return (row == s2.row && col == s2.col); }
     bool equals(int r, int c) const{ return (row == r && col == c); }
     void copy(State& s2) { row = s2.row; col = s2.col; }
@@ -56,16 +58,17 @@ class Maze{
         State* goalstate; //Location of the goal
         char ** grid;
         void InitMaze();
-        bool Bernoulli(double p) const; //Simulate the outcome of a Bernoulli trial with probability p
+        bool Bernoulli(double p, std::mt19937 * rng) const; //Simulate the outcome of a Bernoulli trial with probability p
         
     public:
         Maze(PARAMS& mazeParams);
         
         /* 
          * These functions are used in MCTS/UCT planning
+         * Random numbers come from rng if given, so that several threads can simulate at once, or otherwise from rand()
          */
-        bool Step(State& s, int action, double& reward) const; //Step function for generative planning
-        int SelectRandom(State& s) const; //Return random action for rollouts
+        bool Step(State& s, int action, double& reward, std::mt19937 * rng = 0) const; //Step function for generative planning
+        int SelectRandom(State& s, std::mt19937 * rng = 0) const; //Return random action for rollouts
         /*
          * These functions are used for full-width planning (e.g. VI/PI).
          */
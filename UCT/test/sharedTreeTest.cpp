@@ -0,0 +1,64 @@
+/*
+ * Stress test for tree parallelization.
+ *
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021).
+ *
+ * Runs UCT::SearchShared from the start state with many threads, several times on the same tree and on fresh trees, and fails if a simulation was not counted exactly once at the root or SharedNode::Validate finds lost updates.
+ * Build with -DSANITIZE=thread to also check the atomics and the lazy expansion for data races.
+ * Usage: sharedTreeTest problemfile [threads] [simulations]
+ */
+#include <iostream>
+#include <string>
+#include "maze.h"
+#include "UCT.h"
+#include "SharedTree.h"
+#include "ParserUCT.h"
+
+using std::cout;
+using std::endl;
+
+#define Searches 4 //Searches on the same tree, so later ones run below nodes expanded by earlier ones
+#define Trees 8 //Fresh trees
+
+int main(int argc, char ** argv){
+    if(argc < 2){
+        std::cerr << "Must specify problem file." << endl;
+        return -1;
+    }
+
+    PARAMS mazeParams;
+    UCT_PARAMS uctParams;
+    EXP_PARAMS expParams;
+    if(!PARSER::parseMaze(mazeParams, uctParams, argv[1])){
+        std::cerr << "Could not parse problem file." << endl;
+        return -1;
+    }
+    uctParams.threads = argc > 2 ? std::stoi(argv[2]) : 16;
+    uctParams.parallel = "tree";
+    int nsims = argc > 3 ? std::stoi(argv[3]) : 2000;
+    expParams.verbose = 0;
+
+    Maze M(mazeParams);
+    UCT uct(uctParams, expParams, &M);
+    State start(*uctParams.startstate);
+    int cols = M.getCols();
+
+    bool passed = true;
+    for(int t=0; t < Trees; t++){
+        SharedNode * root = new SharedNode(start.row * cols + start.col);
+        root->Expand(&M);
+        for(int i=1; i <= Searches; i++){
+            uct.SearchShared(root, nsims);
+            bool consistent = root->getCount() == i*nsims && root->Validate();
+            if(!consistent)
+                cout << "Tree " << t << ", search " << i << ": root count = " << root->getCount() << " (expected " << i*nsims << "), valid = " << (root->Validate() ? "yes" : "no") << endl;
+            passed = passed && consistent;
+        }
+        if(t == 0)
+            cout << uctParams.threads << " threads, " << Searches << " x " << nsims << " simulations: " << root->getNumNodes() << " nodes" << endl;
+        delete root;
+    }
+
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}
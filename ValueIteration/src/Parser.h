@@ -21,6 +21,178 @@ using std::endl;
 using std::string;
 
 namespace PARSER{
+    
+    struct COMMAND_LINE{
+        string solver = "vi";
+        int display = 1;
+        int threads = 1;
+        string sweep = "jacobi";
+        int compare = 0;
+        double threshold = 0;
+        int evalSweeps = 10;
+        string order = "rowmajor";
+        int alternate = 0;
+        int multigrid = 0;
+        double replan = 0;
+        string exportFile = "";
+        int workers = 2;
+        int tile = 256;
+        string store = "maze.tiles";
+        string certify = "start";
+        double gap = 0;
+        string batchFile = "";
+        double omega = 0;
+        int history = 2;
+        int period = 20;
+    };
+    
+    /*
+     * Optional parameters following the problem file, e.g. $maze problemfile --solver csr
+     */
+    void parseCommandLine(char ** argv, int argc, COMMAND_LINE& cl){
+        string param, value;
+        for(int i=2; i<argc; i+=2){
+            param = argv[i];
+            
+            if(argc > i+1) value = argv[i+1];
+            if(param == "--help"){
+                cout << "Value iteration for the Maze problem" << endl;
+                cout << "Syntax: maze problemfile [parameters]" << endl;
+                cout << "Parameters" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--solver";
+                cout << std::left << std::setw(100) << "vi (default), csr (VI over a precompiled sparse model), parallel, stencil, sor, anderson, prioritized, reachable, precision, distributed, interval, batch (several reward/discount configurations), tiled (out-of-core), pi or mpi" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--order";
+                cout << std::left << std::setw(100) << "Backup order of the csr solver: rowmajor (default) or goal (BFS outward from the goal)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--alternate";
+                cout << std::left << std::setw(100) << "Alternate forward and backward sweeps in the csr solver (default = 0)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--multigrid";
+                cout << std::left << std::setw(100) << "Warm start VI with a coarse-to-fine multigrid solution (default = 0)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--workers";
+                cout << std::left << std::setw(100) << "No. of worker processes for the distributed solver (default = 2)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--tile";
+                cout << std::left << std::setw(100) << "Tile width of the tiled solver (default = 256)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--store";
+                cout << std::left << std::setw(100) << "File used as tile store by the tiled solver, removed when done (default = maze.tiles)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--certify";
+                cout << std::left << std::setw(100) << "States whose greedy action the interval solver must prove optimal: start (default), all or none" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--gap";
+                cout << std::left << std::setw(100) << "Max. gap between the upper and lower bounds of the interval solver (default = error)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--omega";
+                cout << std::left << std::setw(100) << "Relaxation factor of the sor solver (default = 0: 2/(1 + discount), the largest stable factor)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--history";
+                cout << std::left << std::setw(100) << "No. of previous iterates combined by the anderson solver (default = 2)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--period";
+                cout << std::left << std::setw(100) << "Stencil sweeps between the mixing steps of the anderson solver (default = 20)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--batch";
+                cout << std::left << std::setw(100) << "Configurations of the batch solver, one per line: rStep rOut rTrap rGoal discount" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--threads";
+                cout << std::left << std::setw(100) << "No. of threads for the parallel solver (0 = all cores)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--sweep";
+                cout << std::left << std::setw(100) << "Parallel update order: jacobi (default) or redblack" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--threshold";
+                cout << std::left << std::setw(100) << "Min. value change propagated by prioritized sweeping (default = error)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--evalSweeps";
+                cout << std::left << std::setw(100) << "Evaluation sweeps per policy in modified PI (default = 10)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--compare";
+                cout << std::left << std::setw(100) << "Also run sequential VI and report speedup and value difference (default = 0)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--replan";
+                cout << std::left << std::setw(100) << "Toggle this fraction of the cells between trap and tile, then compare re-planning with a full solve (default = 0)" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--export";
+                cout << std::left << std::setw(100) << "Write the values and policy to this binary policy file" << endl;
+                
+                cout << std::setw(3) << "";
+                cout << std::left << std::setw(20) << "--display";
+                cout << std::left << std::setw(100) << "Display the maze and policy (default = 1)" << endl;
+                
+                exit(0);
+            }
+            
+            else if(param == "--solver")
+                cl.solver = value;
+            else if(param == "--display")
+                cl.display = stoi(value);
+            else if(param == "--order")
+                cl.order = value;
+            else if(param == "--alternate")
+                cl.alternate = stoi(value);
+            else if(param == "--multigrid")
+                cl.multigrid = stoi(value);
+            else if(param == "--workers")
+                cl.workers = stoi(value);
+            else if(param == "--tile")
+                cl.tile = stoi(value);
+            else if(param == "--store")
+                cl.store = value;
+            else if(param == "--certify")
+                cl.certify = value;
+            else if(param == "--gap")
+                cl.gap = stod(value);
+            else if(param == "--omega")
+                cl.omega = stod(value);
+            else if(param == "--history")
+                cl.history = stoi(value);
+            else if(param == "--period")
+                cl.period = stoi(value);
+            else if(param == "--batch")
+                cl.batchFile = value;
+            else if(param == "--threads")
+                cl.threads = stoi(value);
+            else if(param == "--sweep")
+                cl.sweep = value;
+            else if(param == "--threshold")
+                cl.threshold = stod(value);
+            else if(param == "--evalSweeps")
+                cl.evalSweeps = stoi(value);
+            else if(param == "--compare")
+                cl.compare = stoi(value);
+            else if(param == "--replan")
+                cl.replan = stod(value);
+            else if(param == "--export")
+                cl.exportFile = value;
+            else
+                cout << "Unrecognized parameter \"" << param << "\"" << endl;
+        }
+    }
            
     bool parseMaze(PARAMS& mazeParams, VI_PARAMS& viParams, char* inputFile){
         std::ifstream infile(inputFile);
@@ -33,6 +205,8 @@ namespace PARSER{
         string param, s_value;
         int goalC = 0;
         int goalR = 0;
+        int startC = 0;
+        int startR = 0;
         while(infile >> param >> s_value){
             //cout << param << " = " << s_value << endl;
             if(param == "cols")
@@ -47,10 +221,22 @@ namespace PARSER{
                 viParams.discount = stof(s_value);
             else if(param == "error")
                 viParams.error = stof(s_value);
+            else if(param == "rStep")
+                mazeParams.rStep = stod(s_value);
+            else if(param == "rOut")
+                mazeParams.rOut = stod(s_value);
+            else if(param == "rTrap")
+                mazeParams.rTrap = stod(s_value);
+            else if(param == "rGoal")
+                mazeParams.rGoal = stod(s_value);
             else if(param == "goalC")
                 goalC = stoi(s_value);
             else if(param == "goalR")
                 goalR = stoi(s_value);
+            else if(param == "startC")
+                startC = stoi(s_value);
+            else if(param == "startR")
+                startR = stoi(s_value);
             else
                 cout << "\tWarning: \"" << param << "\" is not a valid parameter." << endl;
         }
@@ -62,6 +248,7 @@ namespace PARSER{
         if(goalR == 0) goalR = mazeParams.rows - 1;
         
         mazeParams.goal = new State(goalR, goalC);
+        viParams.startstate = new State(startR, startC);
         
         cout << "Parsed Maze: " << mazeParams.rows << "x" << mazeParams.cols << ", " 
              << mazeParams.traps << " traps, " << "p(traps) = " << mazeParams.p_traps 
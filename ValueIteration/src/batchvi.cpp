@@ -0,0 +1,354 @@
+#include "batchvi.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+
+#define Infinity 1e+10
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCHVI_X86
+#include <immintrin.h>
+#endif
+
+BatchVI::BatchVI(const Maze& maze, const vector<CONFIG>& configs) : configs(configs), stencil(maze, 0.0){
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    rows = maze.getRows();
+    cols = maze.getCols();
+    numStates = rows * cols;
+    goalRow = maze.getGoal().row;
+    goalCol = maze.getGoal().col;
+    assert(!maze.isTerminal(maze.getGoal())); //The cell tables have no absorbing goal
+    int K = configs.size();
+
+    //Successors of every action, as in Maze::expandMDP
+    cells.resize(numStates);
+    trapped.resize(numStates);
+    for(int r=0; r < rows; r++){
+        for(int c=0; c < cols; c++){
+            CELL& cell = cells[r*cols + c];
+            cell.moves = 0;
+            cell.goal = 0;
+            cell.trapped = maze.isTrap(r, c);
+            trapped[r*cols + c] = cell.trapped;
+            for(int a=0; a < 4; a++){
+                int nr = r + dr[a];
+                int nc = c + dc[a];
+                if(nr < 0 || nr >= rows || nc < 0 || nc >= cols){
+                    nr = r;
+                    nc = c;
+                }
+                else
+                    cell.moves |= 1 << a;
+                if(maze.getGoal().equals(nr, nc))
+                    cell.goal |= 1 << a;
+            }
+        }
+    }
+
+    //Maze::expandMDP stores probabilities as float
+    pTrap = maze.getTrapProb();
+    pEscape = (float)(1 - pTrap);
+
+    width = K;
+    V.assign((size_t)numStates * K, 0.0);
+    //Room for padding to 4 lanes, see Retire
+    for(int t=0; t < 4; t++) reward[t].resize(std::max(K, 4));
+    gamma.resize(std::max(K, 4));
+    lane.resize(std::max(K, 4));
+    for(int k=0; k < K; k++){
+        reward[0][k] = configs[k].rStep;
+        reward[1][k] = configs[k].rOut;
+        reward[2][k] = configs[k].rTrap;
+        reward[3][k] = configs[k].rGoal;
+        gamma[k] = configs[k].discount;
+        lane[k] = k;
+    }
+    values.resize(K);
+    iterations.assign(K, 0);
+    backups = 0;
+
+#ifdef BATCHVI_X86
+    avx2 = __builtin_cpu_supports("avx2");
+#else
+    avx2 = false;
+#endif
+}
+
+/*
+ * Back up every lane of a single cell into out[0...width-1]
+ */
+void BatchVI::BackupCell(int r, int c, double * out){
+    const long offset[4] = {-(long)cols*width, (long)cols*width, -width, width};
+    const CELL cell = cells[r*cols + c];
+    const double * v = V.data() + (size_t)(r*cols + c) * width;
+    double pT = cell.trapped ? pTrap : 0.0;
+    double pE = cell.trapped ? pEscape : 1.0;
+
+    const double * n[4];
+    const double * rw[4];
+    for(int a=0; a < 4; a++){
+        bool moves = (cell.moves >> a) & 1;
+        n[a] = moves ? v + offset[a] : v;
+        rw[a] = ((cell.goal >> a) & 1) ? reward[3].data() : (moves ? reward[0].data() : reward[1].data());
+    }
+
+    for(int k=0; k < width; k++){
+        double g = gamma[k];
+        double stay = pT * (reward[2][k] + g*v[k]);
+        double best = -Infinity;
+        for(int a=0; a < 4; a++)
+            best = std::max(best, stay + pE * (rw[a][k] + g*n[a][k]));
+        out[k] = best;
+    }
+}
+
+/*
+ * The successors, probabilities and reward types of a cell are the same in every lane, only the reward values and the discount differ.
+ * Away from the goal, left and right moves of the inner columns always succeed with rStep, and up and down moves do too except in the first and last row, where they stay put with rOut.
+ * The inner columns of a row are backed up in a loop over cells and lanes, with the trap probabilities of a cell shared by its lanes.  FixRow then backs up the remaining cells of the row.
+ * As in VI::PlanStencil, rows are updated in place but the cells of a row are backed up simultaneously.
+ */
+void BatchVI::SweepPortable(double * buffer){
+    const int w = width;
+    const long stride = (long)cols * w;
+    const double * rS = reward[0].data();
+    const double * rT = reward[2].data();
+    const double * g = gamma.data();
+    const double trapP[2] = {0.0, pTrap};
+    const double escapeP[2] = {1.0, pEscape};
+
+    for(int r=0; r < rows; r++){
+        const double * v = V.data() + (size_t)r * stride;
+        const long up = (r > 0) ? stride : 0;
+        const long down = (r < rows-1) ? stride : 0;
+        const double * rU = (r > 0) ? rS : reward[1].data();
+        const double * rD = (r < rows-1) ? rS : reward[1].data();
+
+        for(int c=1; c < cols-1; c++){
+            double pT = trapP[trapped[r*cols + c]];
+            double pE = escapeP[trapped[r*cols + c]];
+            const double * x = v + (long)c*w;
+            double * out = buffer + (long)c*w;
+            for(int k=0; k < w; k++){
+                double side = std::max(x[k-w], x[k+w]);
+                double q = std::max(std::max(rU[k] + g[k]*x[k-up], rD[k] + g[k]*x[k+down]), rS[k] + g[k]*side);
+                out[k] = pT * (rT[k] + g[k]*x[k]) + pE * q;
+            }
+        }
+        FixRow(r, buffer);
+        Store(r, buffer);
+    }
+}
+
+/*
+ * Same as SweepPortable, but every cell backs up its lanes in blocks of 4 with AVX2 instructions.  If the no. of lanes is not a multiple of 4, the last block overlaps the previous one and recomputes some lanes.
+ * Inside the grid, all four moves use rStep, so the best action is the one with the largest neighbour value.
+ * Rows are processed in chunks of about 4 KB per row, so that the neighbouring rows of a chunk stay in the L1 cache while every block of lanes passes over it.
+ */
+#ifdef BATCHVI_X86
+__attribute__((target("avx2")))
+void BatchVI::SweepAVX2(double * buffer){
+    const int w = width;
+    const long stride = (long)cols * w;
+    const int blocks = (w + 3) / 4;
+    const int chunk = std::max(1, 512 / w);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const double trapP[2] = {0.0, pTrap};
+    const double escapeP[2] = {1.0, pEscape};
+
+    for(int r=0; r < rows; r++){
+        double * v = V.data() + (size_t)r * stride;
+        bool inner = r > 0 && r < rows-1;
+        bool nearGoal = std::abs(r - goalRow) <= 1;
+        const long up = (r > 0) ? stride : 0;
+        const long down = (r < rows-1) ? stride : 0;
+        const double * rU = (r > 0) ? reward[0].data() : reward[1].data();
+        const double * rD = (r < rows-1) ? reward[0].data() : reward[1].data();
+
+        for(int first=1; first < cols-1; first += chunk){
+            int last = std::min(cols-1, first + chunk);
+            for(int b=0; b < blocks; b++){
+                int k = std::min(4*b, w-4);
+                __m256d g = _mm256_loadu_pd(gamma.data() + k);
+                __m256d rS = _mm256_loadu_pd(reward[0].data() + k);
+                __m256d rT = _mm256_loadu_pd(reward[2].data() + k);
+                __m256d rUp = _mm256_loadu_pd(rU + k);
+                __m256d rDown = _mm256_loadu_pd(rD + k);
+                __m256d change = _mm256_setzero_pd();
+
+                for(int c=first; c < last; c++){
+                    const double * x = v + (long)c*w + k;
+                    __m256d pT = _mm256_broadcast_sd(trapP + trapped[r*cols + c]);
+                    __m256d pE = _mm256_broadcast_sd(escapeP + trapped[r*cols + c]);
+                    __m256d center = _mm256_loadu_pd(x);
+                    __m256d side = _mm256_max_pd(_mm256_loadu_pd(x - w), _mm256_loadu_pd(x + w));
+                    __m256d q;
+                    if(inner){
+                        __m256d next = _mm256_max_pd(_mm256_max_pd(_mm256_loadu_pd(x - up), _mm256_loadu_pd(x + down)), side);
+                        q = _mm256_add_pd(rS, _mm256_mul_pd(g, next));
+                    }
+                    else{
+                        __m256d qU = _mm256_add_pd(rUp, _mm256_mul_pd(g, _mm256_loadu_pd(x - up)));
+                        __m256d qD = _mm256_add_pd(rDown, _mm256_mul_pd(g, _mm256_loadu_pd(x + down)));
+                        __m256d qS = _mm256_add_pd(rS, _mm256_mul_pd(g, side));
+                        q = _mm256_max_pd(_mm256_max_pd(qU, qD), qS);
+                    }
+                    __m256d stay = _mm256_mul_pd(pT, _mm256_add_pd(rT, _mm256_mul_pd(g, center)));
+                    q = _mm256_add_pd(stay, _mm256_mul_pd(pE, q));
+                    _mm256_storeu_pd(buffer + (long)c*w + k, q);
+                    change = _mm256_max_pd(change, _mm256_andnot_pd(sign, _mm256_sub_pd(q, center)));
+                }
+
+                //Near the goal, FixRow replaces some of the cells and Store computes the changes
+                if(!nearGoal)
+                    _mm256_storeu_pd(delta.data() + k, _mm256_max_pd(change, _mm256_loadu_pd(delta.data() + k)));
+            }
+        }
+        FixRow(r, buffer);
+
+        if(nearGoal)
+            Store(r, buffer);
+        else{
+            for(int k=0; k < w; k++){
+                delta[k] = std::max(delta[k], std::abs(buffer[k] - v[k]));
+                delta[k] = std::max(delta[k], std::abs(buffer[stride - w + k] - v[stride - w + k]));
+            }
+            std::copy(buffer, buffer + stride, v);
+        }
+    }
+}
+#else
+void BatchVI::SweepAVX2(double * buffer){
+    SweepPortable(buffer);
+}
+#endif
+
+/*
+ * With a single lane, V has the layout of a plain grid
+ */
+void BatchVI::SweepStencil(double * buffer){
+    stencil.setRewards(reward[0][0], reward[1][0], reward[2][0], reward[3][0], gamma[0]);
+    for(int r=0; r < rows; r++){
+        delta[0] = std::max(delta[0], stencil.BackupRow(V.data(), buffer, r));
+        std::copy(buffer, buffer + cols, V.begin() + (size_t)r*cols);
+    }
+}
+
+void BatchVI::FixRow(int r, double * buffer){
+    BackupCell(r, 0, buffer);
+    BackupCell(r, cols-1, buffer + (long)(cols-1)*width);
+    if(std::abs(r - goalRow) <= 1)
+        for(int c = std::max(0, goalCol-1); c <= std::min(cols-1, goalCol+1); c++)
+            BackupCell(r, c, buffer + (long)c*width);
+}
+
+void BatchVI::Store(int r, const double * buffer){
+    const int w = width;
+    double * v = V.data() + (size_t)r*cols*w;
+    for(int c=0; c < cols; c++){
+        for(int k=0; k < w; k++){
+            delta[k] = std::max(delta[k], std::abs(buffer[c*w + k] - v[c*w + k]));
+            v[c*w + k] = buffer[c*w + k];
+        }
+    }
+}
+
+/*
+ * Copy the converged lanes to values and pack the remaining lanes into a narrower V.
+ * SweepAVX2 needs 4 lanes, so with AVX2, 2 or 3 remaining configurations are padded to 4 lanes by repeating the last one.  The copies compute exactly the same values and converge together with the original.
+ */
+void BatchVI::Retire(double error, int iter){
+    vector<int> keep;
+    for(int k=0; k < width; k++){
+        if(delta[k] > error){
+            if(keep.empty() || lane[keep.back()] != lane[k]) keep.push_back(k);
+            continue;
+        }
+        iterations[lane[k]] = iter;
+        values[lane[k]].resize(numStates);
+        for(size_t s=0; s < (size_t)numStates; s++)
+            values[lane[k]][s] = V[s*width + k];
+    }
+    int distinct = keep.size();
+    if(avx2 && distinct > 1)
+        while(keep.size() < 4) keep.push_back(keep.back());
+    int w = keep.size();
+    bool unchanged = (w == width);
+    for(int j=0; j < w && unchanged; j++)
+        unchanged = keep[j] == j;
+    if(unchanged) return;
+
+    vector<double> packed((size_t)numStates * w);
+    for(size_t s=0; s < (size_t)numStates; s++)
+        for(int j=0; j < w; j++)
+            packed[s*w + j] = V[s*width + keep[j]];
+    V.swap(packed);
+
+    for(int j=0; j < w; j++){
+        for(int t=0; t < 4; t++) reward[t][j] = reward[t][keep[j]];
+        gamma[j] = gamma[keep[j]];
+        lane[j] = lane[keep[j]];
+    }
+    width = w;
+    padding = w - distinct;
+}
+
+/*
+ * The last lane continues with the Stencil kernel
+ */
+void BatchVI::Plan(double error){
+    vector<double> buffer((size_t)cols * std::max(width, 4));
+    int iter = 0;
+    backups = 0;
+    padding = 0;
+    if(avx2 && width > 1 && width < 4){
+        delta.assign(width, Infinity);
+        Retire(error, 0); //Pad to 4 lanes
+    }
+
+    while(width > 0){
+        delta.assign(width, 0.0);
+        if(width == 1)
+            SweepStencil(buffer.data());
+        else if(avx2 && width >= 4)
+            SweepAVX2(buffer.data());
+        else
+            SweepPortable(buffer.data());
+        iter++;
+        backups += (long)(width - padding) * numStates;
+        Retire(error, iter);
+    }
+
+    std::cout << "Batched VI (" << configs.size() << " configurations, " << (avx2 ? "AVX2" : "portable") << " lanes) finished after " << iter << " iterations." << std::endl;
+}
+
+bool BatchVI::ReadConfigs(const std::string& file, vector<CONFIG>& configs){
+    std::ifstream infile(file);
+    if(!infile.is_open()){
+        std::cerr << "Could not open file \"" << file << "\"." << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(infile, line)){
+        if(line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        CONFIG config;
+        if(!(fields >> config.rStep >> config.rOut >> config.rTrap >> config.rGoal >> config.discount)){
+            std::cerr << "Invalid configuration \"" << line << "\" in \"" << file << "\"." << std::endl;
+            return false;
+        }
+        configs.push_back(config);
+    }
+
+    if(configs.empty()){
+        std::cerr << "\"" << file << "\" contains no configurations." << std::endl;
+        return false;
+    }
+    return true;
+}
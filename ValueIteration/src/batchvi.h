@@ -0,0 +1,80 @@
+/*
+ * BatchVI:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * Value iteration for K reward/discount configurations of the same grid at once.
+ *
+ * The K values of a state are stored contiguously (lane k of state s at V[s*width + k]), so one pass over the grid computes the successors, trap probabilities and reward types of a cell once, and backs up all K lanes with the same vector instructions.
+ * Each configuration stops on its own convergence: converged lanes are moved out of V, and the remaining lanes are packed more densely, so later sweeps only touch the lanes still running.
+ * Once a single lane is left, V is a plain grid of values and the sweeps continue with the Stencil kernel, set to the rewards and discount of that lane.
+ */
+
+#ifndef BATCHVI_H
+#define BATCHVI_H
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include "maze.h"
+#include "stencil.h"
+
+using std::vector;
+
+class BatchVI{
+    public:
+        struct CONFIG{
+            double rStep, rOut, rTrap, rGoal;
+            float discount;
+        };
+
+        BatchVI(const Maze& maze, const vector<CONFIG>& configs);
+
+        void Plan(double error); //Sweep until every configuration has converged with the given error
+
+        static bool ReadConfigs(const std::string& file, vector<CONFIG>& configs); //One configuration per line: rStep rOut rTrap rGoal discount
+
+        double getValue(int config, int s) const { return values[config][s]; }
+        int getIterations(int config) const { return iterations[config]; }
+        long getBackups() const { return backups; }
+        int getConfigs() const { return configs.size(); }
+        bool hasAVX2() const { return avx2; }
+
+    private:
+        struct CELL{
+            uint8_t moves; //Bit a is set if action a leaves the cell
+            uint8_t goal; //Bit a is set if action a reaches the goal
+            uint8_t trapped;
+        };
+
+        int rows, cols, numStates;
+        int goalRow, goalCol;
+        vector<CONFIG> configs;
+        vector<CELL> cells; //Transition structure, shared by all lanes
+        vector<uint8_t> trapped; //Trap bit of every cell
+        double pTrap, pEscape; //Rounded like Maze::expandMDP
+        bool avx2; //Use the AVX2 sweep
+        Stencil stencil; //Kernel for the last lane
+
+        //Active lanes
+        int width; //No. of lanes that have not converged
+        int padding; //No. of lanes that repeat another configuration (see Retire)
+        vector<double> V; //numStates x width values
+        vector<double> reward[4]; //rStep, rOut, rTrap and rGoal per lane
+        vector<double> gamma; //Discount per lane
+        vector<int> lane; //Configuration in every lane
+        vector<double> delta; //Max. change of every lane during a sweep
+
+        vector< vector<double> > values; //Values of the converged configurations
+        vector<int> iterations; //Sweeps until each configuration converged
+        long backups; //No. of single-lane backups
+
+        void SweepPortable(double * buffer); //Back up every lane of every row, updating delta
+        void SweepAVX2(double * buffer); //Same, with 4 lanes per AVX2 instruction (at least 4 lanes)
+        void SweepStencil(double * buffer); //Same, for a single lane
+        void FixRow(int r, double * buffer); //Back up the border columns and the goal and its neighbours in row r
+        void Store(int r, const double * buffer); //Update delta and copy the new values of row r into V
+        void BackupCell(int r, int c, double * out); //Back up every lane of cell (r,c), including the border and goal cases
+        void Retire(double error, int iter); //Move the converged lanes out of V
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * BFloat16:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * Compact value type for memory-bound planning.
+ * Rounding to nearest loses every update smaller than half the spacing of the stored values, so VI stalls far from V*.  RoundStochastic rounds up or down with probabilities that make the stored value exact in expectation, so small updates are not lost on average.
+ */
+
+#ifndef BFLOAT16_H
+#define BFLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+
+/*
+ * 16-bit brain floating point: the upper half of a float (8 exponent bits, 7 mantissa bits), rounded to nearest even
+ */
+struct BFloat16{
+    uint16_t bits;
+
+    BFloat16(){ bits = 0; }
+    BFloat16(double v){
+        float f = v;
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        u += 0x7FFF + ((u >> 16) & 1);
+        bits = u >> 16;
+    }
+    operator double() const{
+        uint32_t u = (uint32_t)bits << 16;
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+};
+
+/*
+ * Round v to the given no. of mantissa bits (7 for bfloat16): a random number from the xorshift generator in seed is added to the bits that are dropped, so v rounds up with probability equal to its distance from the lower value
+ */
+inline double RoundStochastic(double v, int bits, uint64_t& seed){
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    uint64_t u;
+    std::memcpy(&u, &v, sizeof(u));
+    uint64_t dropped = ((uint64_t)1 << (52 - bits)) - 1;
+    u = (u + (seed & dropped)) & ~dropped;
+    std::memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+#endif
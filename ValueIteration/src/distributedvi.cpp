@@ -0,0 +1,177 @@
+#include "distributedvi.h"
+
+#include <iostream>
+#include <cstddef>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/*
+ * Blocking transfers of whole buffers
+ */
+static bool SendAll(int fd, const void * buffer, size_t bytes){
+    const char * p = (const char *)buffer;
+    while(bytes > 0){
+        ssize_t n = send(fd, p, bytes, MSG_NOSIGNAL); //A failed worker must not kill the others
+        if(n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+static bool RecvAll(int fd, void * buffer, size_t bytes){
+    char * p = (char *)buffer;
+    while(bytes > 0){
+        ssize_t n = read(fd, p, bytes);
+        if(n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+DistributedVI::DistributedVI(const Stencil& stencil, int workers) : stencil(stencil){
+    rows = stencil.getRows();
+    cols = stencil.getCols();
+    this->workers = std::max(1, std::min(workers, rows));
+    iter = 0;
+    haloBytes = 0;
+}
+
+/*
+ * The strip is stored with one halo row above and below.  Row r of the grid is at local row r - first + 1, so the stencil kernel is given a pointer shifted by first - 1 rows and only ever reads rows first-1...last.
+ *
+ * Halos are exchanged from top to bottom: a worker first receives the halo from the strip above and answers with its own first row, then sends its last row to the strip below and waits for the reply.
+ * Every transfer has a receiver waiting for it, so rows larger than the socket buffers cannot deadlock.
+ */
+void DistributedVI::Work(const STRIP& strip, const double * V){
+    int h = strip.last - strip.first;
+    vector<double> local((size_t)(h + 2) * cols, 0.0);
+    vector<double> row(cols);
+    size_t rowBytes = cols * sizeof(double);
+
+    for(int r = std::max(0, strip.first - 1); r < std::min(rows, strip.last + 1); r++)
+        std::copy(V + (size_t)r*cols, V + (size_t)(r+1)*cols, local.begin() + (size_t)(r - strip.first + 1)*cols);
+    double * grid = local.data() - (std::ptrdiff_t)(strip.first - 1) * cols; //Indexed by global row
+
+    char go = 1;
+    while(go){
+        double delta = 0.0;
+        for(int r = strip.first; r < strip.last; r++){
+            delta = std::max(delta, stencil.BackupRow(grid, row.data(), r));
+            std::copy(row.begin(), row.end(), grid + (size_t)r*cols);
+        }
+
+        bool ok = true;
+        if(strip.up >= 0){
+            ok = ok && RecvAll(strip.up, grid + (size_t)(strip.first - 1)*cols, rowBytes);
+            ok = ok && SendAll(strip.up, grid + (size_t)strip.first*cols, rowBytes);
+        }
+        if(strip.down >= 0){
+            ok = ok && SendAll(strip.down, grid + (size_t)(strip.last - 1)*cols, rowBytes);
+            ok = ok && RecvAll(strip.down, grid + (size_t)strip.last*cols, rowBytes);
+        }
+        ok = ok && SendAll(strip.control, &delta, sizeof(delta));
+        ok = ok && RecvAll(strip.control, &go, sizeof(go));
+        if(!ok) _exit(1);
+    }
+
+    //Return the strip to the coordinator
+    if(!SendAll(strip.control, grid + (size_t)strip.first*cols, (size_t)h * rowBytes)) _exit(1);
+}
+
+bool DistributedVI::Plan(double * V, double error){
+    vector<STRIP> strips(workers);
+    vector<int> coordinator(workers); //Coordinator ends of the control sockets
+    int fds[2];
+
+    for(int k=0; k < workers; k++){
+        strips[k].first = (long)rows * k / workers;
+        strips[k].last = (long)rows * (k+1) / workers;
+        strips[k].up = -1;
+        strips[k].down = -1;
+
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0){
+            std::cerr << "Could not create control socket for worker " << k << "." << std::endl;
+            return false;
+        }
+        coordinator[k] = fds[0];
+        strips[k].control = fds[1];
+
+        if(k > 0){
+            if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0){
+                std::cerr << "Could not create halo socket between workers " << k-1 << " and " << k << "." << std::endl;
+                return false;
+            }
+            strips[k-1].down = fds[0];
+            strips[k].up = fds[1];
+        }
+    }
+
+    vector<pid_t> pids(workers);
+    for(int k=0; k < workers; k++){
+        pids[k] = fork();
+        if(pids[k] < 0){
+            std::cerr << "Could not start worker " << k << "." << std::endl;
+            //The workers already started see their sockets close and exit
+            for(int j=0; j < workers; j++){
+                close(coordinator[j]);
+                close(strips[j].control);
+                if(strips[j].down >= 0) close(strips[j].down);
+                if(strips[j].up >= 0) close(strips[j].up);
+            }
+            for(int j=0; j < k; j++)
+                waitpid(pids[j], 0, 0);
+            return false;
+        }
+        if(pids[k] == 0){
+            //Keep only this worker's sockets
+            for(int j=0; j < workers; j++){
+                close(coordinator[j]);
+                if(j != k){
+                    close(strips[j].control);
+                    if(strips[j].down >= 0) close(strips[j].down);
+                    if(strips[j].up >= 0) close(strips[j].up);
+                }
+            }
+            Work(strips[k], V);
+            _exit(0);
+        }
+    }
+    for(int k=0; k < workers; k++){
+        close(strips[k].control);
+        if(strips[k].down >= 0) close(strips[k].down);
+        if(strips[k].up >= 0) close(strips[k].up);
+    }
+
+    //Global convergence check
+    bool ok = true;
+    iter = 0;
+    char go = 1;
+    while(ok && go){
+        double delta = 0.0;
+        for(int k=0; k < workers && ok; k++){
+            double d;
+            ok = RecvAll(coordinator[k], &d, sizeof(d));
+            delta = std::max(delta, d);
+        }
+        iter++;
+        go = delta > error;
+        for(int k=0; k < workers && ok; k++)
+            ok = SendAll(coordinator[k], &go, sizeof(go));
+    }
+    for(int k=0; k < workers && ok; k++)
+        ok = RecvAll(coordinator[k], V + (size_t)strips[k].first*cols, (size_t)(strips[k].last - strips[k].first) * cols * sizeof(double));
+
+    for(int k=0; k < workers; k++){
+        close(coordinator[k]);
+        int status;
+        waitpid(pids[k], &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    if(!ok) std::cerr << "A worker failed." << std::endl;
+
+    haloBytes = 2.0 * (workers - 1) * cols * sizeof(double) * iter;
+    return ok;
+}
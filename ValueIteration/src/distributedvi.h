@@ -0,0 +1,48 @@
+/*
+ * DistributedVI:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * Domain-decomposed value iteration with several worker processes.
+ *
+ * The grid is split into strips of consecutive rows, one per worker.  Each worker is a separate process (fork) that keeps only its strip of V plus one halo row above and below, and sweeps it with the stencil kernel.
+ * After every sweep neighbouring workers exchange their boundary rows over Unix-domain sockets, and report their max. change to the coordinator (the calling process), which decides whether to continue.
+ * When the global max. change is below the error, the workers send their strips back and V is assembled in the coordinator.
+ *
+ * Workers only communicate through the sockets, so the same protocol works over network sockets between hosts.
+ */
+
+#ifndef DISTRIBUTEDVI_H
+#define DISTRIBUTEDVI_H
+
+#include <vector>
+#include "stencil.h"
+
+using std::vector;
+
+class DistributedVI{
+    private:
+        struct STRIP{
+            int first, last; //Rows first...last-1
+            int up, down; //Sockets to the neighbouring strips (-1 at the top/bottom of the grid)
+            int control; //Socket to the coordinator
+        };
+
+        const Stencil& stencil; //Grid model and backup kernel
+        int rows, cols;
+        int workers;
+        int iter; //No. of sweeps
+        double haloBytes; //Bytes exchanged between workers
+
+        void Work(const STRIP& strip, const double * V); //Main loop of a worker process
+
+    public:
+        DistributedVI(const Stencil& stencil, int workers);
+
+        bool Plan(double * V, double error); //Start the workers from V and write the solution to V.  Returns false if the workers could not be started
+
+        int getIterations() const { return iter; }
+        int getWorkers() const { return workers; }
+        double getHaloBytes() const { return haloBytes; }
+};
+
+#endif
@@ -5,8 +5,12 @@
  */
 #include <iostream>
 #include <cstring>
+#include <chrono>
 #include "maze.h"
 #include "vi.h"
+#include "pi.h"
+#include "tiledvi.h"
+#include "batchvi.h"
 #include "Parser.h"
 
 using std::cout;
@@ -15,6 +19,7 @@ using std::endl;
 int main(int argc, char ** argv){
     PARAMS mazeParams;
     VI_PARAMS viParams;
+    PARSER::COMMAND_LINE cl;
     
     char * inputFile;
     if(argc >= 2){
@@ -25,25 +30,284 @@ int main(int argc, char ** argv){
         return -1;
     }
     
+    PARSER::parseCommandLine(argv, argc, cl);
+    
     if(!PARSER::parseMaze(mazeParams, viParams, inputFile)){
         std::cerr << "Could not parse problem file." << endl;
         return -1;
     }       
     
+    //Assign values parsed from command line
+    viParams.threads = cl.threads;
+    viParams.sweep = cl.sweep;
+    viParams.threshold = cl.threshold;
+    viParams.evalSweeps = cl.evalSweeps;
+    viParams.order = cl.order;
+    viParams.alternate = cl.alternate;
+    viParams.workers = cl.workers;
+    viParams.certify = cl.certify;
+    viParams.gap = cl.gap;
+    viParams.omega = cl.omega;
+    viParams.history = cl.history;
+    viParams.period = cl.period;
+    
+    //Out-of-core VI generates the maze directly into its tile store, so the maze is never held in memory
+    if(cl.solver == "tiled"){
+        TiledVI tiled(mazeParams, viParams.discount, cl.tile);
+        if(!tiled.Open(cl.store)) return -1;
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        tiled.Plan(viParams.error);
+        auto stop = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double, std::milli>(stop - start).count();
+        cout << "Solver \"tiled\" took " << time << " ms." << endl;
+        
+        if(cl.compare){
+            Maze M(mazeParams);
+            VI reference(viParams, &M);
+            reference.PlanStencil();
+            
+            double maxDiff = 0.0;
+            for(int r=0; r < M.getRows(); r++)
+                for(int c=0; c < M.getCols(); c++)
+                    maxDiff = std::max(maxDiff, std::abs(tiled.getValue(r, c) - reference.getValues()[r*M.getCols() + c]));
+            cout << "Max. value difference to stencil VI = " << maxDiff << endl;
+            cout << "Backups: " << tiled.getBackups() << " (tiled) vs. " << reference.getBackups() << " (full sweeps)" << endl;
+        }
+        return 0;
+    }
+    
     //Create maze with parameters
     Maze * M = new Maze(mazeParams);    
-    cout << "Maze: " << endl;
-    cout << *M << endl;
+    if(cl.display){
+        cout << "Maze: " << endl;
+        cout << *M << endl;
+    }
+    
+    //Batched VI solves every configuration in the batch file on the same grid
+    if(cl.solver == "batch"){
+        vector<BatchVI::CONFIG> configs;
+        if(!BatchVI::ReadConfigs(cl.batchFile, configs)) return -1;
+        
+        BatchVI batch(*M, configs);
+        auto start = std::chrono::high_resolution_clock::now();
+        batch.Plan(viParams.error);
+        auto stop = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double, std::milli>(stop - start).count();
+        cout << "Solver \"batch\" took " << time << " ms for " << batch.getBackups() << " backups." << endl;
+        
+        //One separate stencil VI run per configuration
+        if(cl.compare){
+            double separateTime = 0.0;
+            long separateBackups = 0;
+            for(int k=0; k < batch.getConfigs(); k++){
+                PARAMS params = mazeParams;
+                params.rStep = configs[k].rStep;
+                params.rOut = configs[k].rOut;
+                params.rTrap = configs[k].rTrap;
+                params.rGoal = configs[k].rGoal;
+                VI_PARAMS single = viParams;
+                single.discount = configs[k].discount;
+                Maze maze(params);
+                VI vi(single, &maze);
+                
+                start = std::chrono::high_resolution_clock::now();
+                vi.PlanStencil();
+                stop = std::chrono::high_resolution_clock::now();
+                separateTime += std::chrono::duration<double, std::milli>(stop - start).count();
+                separateBackups += vi.getBackups();
+                
+                double maxDiff = 0.0;
+                for(int s=0; s < maze.getNumStates(); s++)
+                    maxDiff = std::max(maxDiff, std::abs(batch.getValue(k, s) - vi.getValues()[s]));
+                cout << "Configuration " << k << ": " << batch.getIterations(k) << " iterations (batched) vs. " << vi.getBackups() / maze.getNumStates()
+                     << " (separate), max. value difference = " << maxDiff << endl;
+            }
+            cout << "Separate stencil VI runs took " << separateTime << " ms for " << separateBackups << " backups, speedup = " << separateTime / time << endl;
+        }
+        delete M;
+        return 0;
+    }
     
     //Create VI with parameters
     VI vi(viParams, M);
+    PI * pi = 0;
     //vi.DisplayPolicy(); //Display current policy before value approximation
     
     //Perform value iteration until error criteria is met
-    vi.Plan();
+    auto start = std::chrono::high_resolution_clock::now();
+    if(cl.multigrid)
+        vi.WarmStart();
+    if(cl.solver == "vi")
+        vi.Plan();
+    else if(cl.solver == "csr")
+        vi.PlanSparse();
+    else if(cl.solver == "parallel")
+        vi.PlanParallel();
+    else if(cl.solver == "stencil")
+        vi.PlanStencil();
+    else if(cl.solver == "sor")
+        vi.PlanSOR();
+    else if(cl.solver == "anderson")
+        vi.PlanAnderson();
+    else if(cl.solver == "prioritized")
+        vi.PlanPrioritized();
+    else if(cl.solver == "precision")
+        vi.PlanPrecision();
+    else if(cl.solver == "reachable")
+        vi.PlanReachable();
+    else if(cl.solver == "distributed"){
+        if(!vi.PlanDistributed()) return -1;
+    }
+    else if(cl.solver == "interval")
+        vi.PlanInterval();
+    else if(cl.solver == "pi" || cl.solver == "mpi"){
+        if(cl.multigrid) cout << "The multigrid warm start only applies to VI solvers." << endl;
+        pi = new PI(viParams, M);
+        if(cl.solver == "pi")
+            pi->Plan();
+        else
+            pi->PlanModified();
+        vi.setValues(pi->getValues()); //Policy display and comparison use the VI values
+    }
+    else{
+        std::cerr << "Unknown solver \"" << cl.solver << "\"." << endl;
+        return -1;
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    double time = std::chrono::duration<double, std::milli>(stop - start).count();
+    cout << "Solver \"" << cl.solver << "\" took " << time << " ms." << endl;
+    long backups = pi ? pi->getBackups() : vi.getBackups() + vi.getWarmStartBackups();
+    
+    //Compare against the sequential reference implementation
+    if(cl.compare){
+        VI reference(viParams, M);
+        start = std::chrono::high_resolution_clock::now();
+        reference.Plan();
+        stop = std::chrono::high_resolution_clock::now();
+        double refTime = std::chrono::duration<double, std::milli>(stop - start).count();
+        
+        //Only the states solved by the planner are compared
+        vector<int> states = vi.getReachable();
+        if(states.empty())
+            for(int i=0; i < M->getNumStates(); i++) states.push_back(i);
+        
+        double maxDiff = 0.0;
+        for(int i : states)
+            maxDiff = std::max(maxDiff, std::abs(vi.getValues()[i] - reference.getValues()[i]));
+        
+        //Greedy actions that are worse than the reference action under the reference values.  Actions whose values differ by less than the value error are ties
+        Stencil kernel(*M, viParams.discount);
+        const int8_t * policy = vi.policy();
+        const int8_t * refPolicy = reference.policy();
+        double tie = 2 * viParams.discount * maxDiff + 1e-12;
+        int policyDiff = 0;
+        for(int s : states){
+            int r = s / M->getCols();
+            int c = s % M->getCols();
+            if(policy[s] != refPolicy[s] && kernel.Q(reference.getValues(), r, c, policy[s]) < kernel.Q(reference.getValues(), r, c, refPolicy[s]) - tie)
+                policyDiff++;
+        }
+        
+        cout << "Sequential VI took " << refTime << " ms, speedup = " << refTime / time
+             << ", max. value difference = " << maxDiff << ", policy differs in " << policyDiff << " states" << endl;
+        cout << "Backups: " << backups << " (" << cl.solver << ") vs. " << reference.getBackups() << " (full sweeps)" << endl;
+        
+        //Sparse VI over all states, for a comparison with the same backup
+        if(cl.solver == "reachable"){
+            VI full(viParams, M);
+            start = std::chrono::high_resolution_clock::now();
+            full.PlanSparse();
+            stop = std::chrono::high_resolution_clock::now();
+            double fullTime = std::chrono::duration<double, std::milli>(stop - start).count();
+            cout << "Sparse VI over all " << M->getNumStates() << " states took " << fullTime << " ms, speedup = " << fullTime / time << endl;
+        }
+        
+        //Sweeps until the max. residual is below the error, as in every other solver
+        if(cl.solver == "interval"){
+            VI residual(viParams, M);
+            residual.PlanStencil();
+            int sweeps = vi.getBackups() / (2L * M->getNumStates());
+            int residualSweeps = residual.getBackups() / M->getNumStates();
+            int s0 = viParams.startstate->row * M->getCols() + viParams.startstate->col;
+            cout << "Sweeps: " << sweeps << " (interval, 2 backups per state) vs. " << residualSweeps << " (residual below " << viParams.error
+                 << "), saved " << residualSweeps - sweeps << " sweeps. Action in the start state: ";
+            M->DisplayAction(policy[s0], cout);
+            cout << " (interval) vs. ";
+            M->DisplayAction(refPolicy[s0], cout);
+            cout << " (sequential VI)" << endl;
+        }
+        
+        //Accelerated solvers use the stencil sweep, so plain stencil VI shows what the acceleration saves
+        if(cl.solver == "sor" || cl.solver == "anderson"){
+            VI plain(viParams, M);
+            start = std::chrono::high_resolution_clock::now();
+            plain.PlanStencil();
+            stop = std::chrono::high_resolution_clock::now();
+            double plainTime = std::chrono::duration<double, std::milli>(stop - start).count();
+            cout << "Sweeps: " << backups / M->getNumStates() << " (" << cl.solver << ") vs. " << plain.getBackups() / M->getNumStates()
+                 << " (stencil), time: " << time << " ms vs. " << plainTime << " ms, speedup = " << plainTime / time << endl;
+        }
+        
+        //Both stencil kernels must reproduce the expandMDP backup of the converged values
+        if(cl.solver == "stencil")
+            cout << "Stencil backup vs. expandMDP backup: max. difference = " << kernel.Verify(*M, reference.getValues()) << endl;
+    }
+    
+    //Write the policy file and check that it maps back to the same values
+    if(cl.exportFile != ""){
+        if(!vi.Export(cl.exportFile)) return -1;
+        
+        PolicyFile policy;
+        start = std::chrono::high_resolution_clock::now();
+        bool opened = policy.Open(cl.exportFile);
+        stop = std::chrono::high_resolution_clock::now();
+        if(!opened) return -1;
+        
+        bool same = std::equal(vi.getValues(), vi.getValues() + M->getNumStates(), policy.getValues());
+        cout << "Exported policy to \"" << cl.exportFile << "\", mapped back in " << std::chrono::duration<double, std::milli>(stop - start).count()
+             << " ms, values " << (same ? "match" : "DO NOT match") << "." << endl;
+    }
+    
+    //Edit the maze and compare incremental re-planning with a full solve of the edited maze
+    if(cl.replan > 0){
+        int rows = M->getRows();
+        int cols = M->getCols();
+        int edits = std::max(1, (int)(cl.replan * M->getNumStates()));
+        vector<State> changed;
+        vector<char> toggled(M->getNumStates(), 0);
+        while((int)changed.size() < edits){
+            int r = rand() % rows;
+            int c = rand() % cols;
+            if(toggled[r*cols + c] || M->getGoal().equals(r, c)) continue;
+            toggled[r*cols + c] = 1;
+            M->setTrap(r, c, !M->isTrap(r, c));
+            changed.push_back(State(r, c));
+        }
+        
+        start = std::chrono::high_resolution_clock::now();
+        vi.Replan(vi.getValues(), changed);
+        stop = std::chrono::high_resolution_clock::now();
+        double replanTime = std::chrono::duration<double, std::milli>(stop - start).count();
+        
+        VI full(viParams, M);
+        start = std::chrono::high_resolution_clock::now();
+        full.PlanStencil();
+        stop = std::chrono::high_resolution_clock::now();
+        double fullTime = std::chrono::duration<double, std::milli>(stop - start).count();
+        
+        double maxDiff = 0.0;
+        for(int i=0; i < M->getNumStates(); i++)
+            maxDiff = std::max(maxDiff, std::abs(vi.getValues()[i] - full.getValues()[i]));
+        
+        cout << "Re-planning after " << edits << " trap changes took " << replanTime << " ms and " << vi.getBackups() << " backups, full solve took "
+             << fullTime << " ms and " << full.getBackups() << " backups, speedup = " << fullTime / replanTime << ", max. value difference = " << maxDiff << endl;
+    }
     
     //Display the current policy after value approximation
-    vi.DisplayPolicy();
+    if(cl.display)
+        vi.DisplayPolicy();
     
+    delete pi;
     return 0;
 }
@@ -2,10 +2,15 @@
 
 Maze::Maze(PARAMS& params){
     cols = params.cols;
-    rows = params.cols;
+    rows = params.rows;
     traps = params.traps;
     p_traps = params.p_traps;
     goalstate = params.goal;
+    terminalGoal = params.terminalGoal;
+    rStep = params.rStep;
+    rOut = params.rOut;
+    rTrap = params.rTrap;
+    rGoal = params.rGoal;
     
     //Change to use variable random seed
     //srand (time(NULL));
@@ -17,10 +22,11 @@ Maze::Maze(PARAMS& params){
  * Initialize maze using given parameters
  */
 void Maze::InitMaze(){
-    //Set up grid tiles
+    //Set up grid tiles.  All rows share one contiguous allocation
     grid = new char*[rows];
+    grid[0] = new char[(size_t)rows * cols];
     for(int i=0; i < rows; i++){
-        grid[i] = new char[cols];
+        grid[i] = grid[0] + (size_t)i * cols;
         for(int j=0; j < cols; j++){
             grid[i][j] = tile;
         }
@@ -41,6 +47,27 @@ void Maze::InitMaze(){
      }
 }
 
+/*
+ * Add or remove a trap
+ */
+void Maze::setTrap(int r, int c, bool trapped){
+    if(grid[r][c] == goal) return;
+    if(trapped && grid[r][c] != trap) traps++;
+    if(!trapped && grid[r][c] == trap) traps--;
+    grid[r][c] = trapped ? trap : tile;
+}
+
+/*
+ * Move the goal
+ */
+void Maze::setGoal(int r, int c){
+    grid[goalstate->row][goalstate->col] = tile;
+    if(grid[r][c] == trap) traps--;
+    goalstate->row = r;
+    goalstate->col = c;
+    grid[r][c] = goal;
+}
+
 /*
  * Expand an MDP state-action transition and list all resulting states, rewards and probabilities
  * 
@@ -51,6 +78,14 @@ void Maze::expandMDP(const State& origin, int action, vector<State>& nextStatesV
     double prob = 1.0;
     double reward;
     
+    //An absorbing goal loops on itself with no reward
+    if(isTerminal(origin)){
+        nextStatesV.push_back(origin);
+        probabilityV.push_back(1.0);
+        rewardV.push_back(0.0);
+        return;
+    }
+    
     //If on top of trap
     if(grid[origin.row][origin.col] == trap){
         State s(origin.row,origin.col);
@@ -42,6 +42,13 @@ struct PARAMS{
     int traps; //No. of traps
     float p_traps = 0.5; //Probability of getting trapped
     State* goal; //Location of the goal
+    bool terminalGoal = false; //Goal is absorbing with no further rewards, as in Step.  Honoured by expandMDP and Stencil; not supported by BatchVI, TiledVI and Multigrid
+    
+    //Reward distribution
+    double rStep = -1; //Move to a neighbouring cell
+    double rOut = -10; //Move against the border
+    double rTrap = -5; //Remain trapped
+    double rGoal = 10; //Reach the goal
 };
 
 /*
@@ -54,6 +61,7 @@ class Maze{
         float p_traps; //Prob. of getting trapped
         float discount; //Discount factor
         State* goalstate; //Location of the goal
+        bool terminalGoal; //Goal is absorbing
         char ** grid;
         void InitMaze();
         bool Bernoulli(double p) const; //Simulate the outcome of a Bernoulli trial with probability p
@@ -81,9 +89,20 @@ class Maze{
         int getNumActions() const { return nActions; }
         char ** getGrid(){ return grid; }
         bool validateState(const State& s) const { return (s.row >=0 && s.row < rows && s.col >= 0 && s.col < cols); }
+        bool isTrap(int r, int c) const { return grid[r][c] == trap; }
+        const State& getGoal() const { return *goalstate; }
+        bool isTerminal(const State& s) const { return terminalGoal && goalstate->equals(s.row, s.col); }
+        float getTrapProb() const { return p_traps; }
+        void getRewards(double& step, double& out, double& trapped, double& atGoal) const{ step = rStep; out = rOut; trapped = rTrap; atGoal = rGoal; }
         
         void getActions(State& s, vector<int>& actions) const; //Get all actions available in state s
         
+        /*
+         * Edits, e.g. for re-planning
+         */
+        void setTrap(int r, int c, bool trapped); //Add or remove a trap (the goal cannot be trapped)
+        void setGoal(int r, int c); //Move the goal to (r,c), removing any trap there
+        
         /*
          * Output
          */
@@ -93,12 +112,12 @@ class Maze{
     
     protected:        
         /*
-         * Reward distribution (change if desired):
+         * Reward distribution (set in PARAMS):
          */
-        int rStep = -1;
-        int rOut = -10;
-        int rTrap = -5;
-        int rGoal = 10;
+        double rStep;
+        double rOut;
+        double rTrap;
+        double rGoal;
         
         //Actions:
         int nActions = 4;
@@ -0,0 +1,275 @@
+#include "multigrid.h"
+#include "stencil.h"
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+
+using std::cout;
+using std::endl;
+
+Multigrid::Multigrid(const Maze& maze, double discount, double error, int factor, int minSize){
+    assert(!maze.isTerminal(maze.getGoal())); //Coarse levels and GoalValue assume a non-terminal goal
+    this->discount = discount;
+    this->error = std::max(error, 1e-2); //Coarse models are approximations, solving them exactly does not pay off
+    backups = 0;
+
+    double goalV = GoalValue(maze, discount);
+    
+    //Add levels from fine to coarse while they are large enough, then store them coarse to fine.
+    //The finest level has blocks of factor^2 cells: on maze1000.prob, 2x2 blocks take most of the coarse solve time and are almost entirely reset by Monotone (1540 fine sweeps instead of 1380)
+    int size = std::max(maze.getRows(), maze.getCols());
+    for(int block = factor * factor; (size + block - 1) / block >= minSize; block *= factor)
+        levels.push_back(Aggregate(maze, discount, block, goalV));
+    std::reverse(levels.begin(), levels.end());
+}
+
+/*
+ * Aggregate the maze into blocks of block x block cells
+ */
+Multigrid::LEVEL Multigrid::Aggregate(const Maze& maze, double discount, int block, double goalV){
+    LEVEL level;
+    level.block = block;
+    level.rows = (maze.getRows() + block - 1) / block;
+    level.cols = (maze.getCols() + block - 1) / block;
+
+    //Trap density of every block
+    vector<int> traps(level.rows * level.cols, 0);
+    vector<int> cells(level.rows * level.cols, 0);
+    for(int r=0; r < maze.getRows(); r++){
+        for(int c=0; c < maze.getCols(); c++){
+            int s = (r / block) * level.cols + c / block;
+            cells[s]++;
+            if(maze.isTrap(r, c)) traps[s]++;
+        }
+    }
+    level.trapP.resize(traps.size());
+    for(int s=0; s < traps.size(); s++)
+        level.trapP[s] = maze.getTrapProb() * traps[s] / cells[s];
+
+    level.goalRow = maze.getGoal().row / block;
+    level.goalCol = maze.getGoal().col / block;
+
+    //One coarse move takes block fine steps
+    double rStep, rOut, rTrap, rGoal;
+    maze.getRewards(rStep, rOut, rTrap, rGoal);
+    double scale = (1 - std::pow(discount, block)) / (1 - discount);
+    level.rStep = rStep * scale;
+    level.rOut = rOut * scale;
+    level.rTrap = rTrap * scale;
+    level.discount = std::pow(discount, block);
+
+    level.goalV = goalV;
+
+    return level;
+}
+
+/*
+ * The goal is not terminal, so its value depends on what the agent can do around it (e.g. step out and back in, or stay put at the border).
+ * Solve the fine maze exactly in a small window around the goal, where actions leaving the window are not allowed.
+ */
+double Multigrid::GoalValue(const Maze& maze, double discount){
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    const int radius = 2;
+    double rStep, rOut, rTrap, rGoal;
+    maze.getRewards(rStep, rOut, rTrap, rGoal);
+    
+    State goal = maze.getGoal();
+    int top = std::max(0, goal.row - radius);
+    int left = std::max(0, goal.col - radius);
+    int rows = std::min(maze.getRows(), goal.row + radius + 1) - top;
+    int cols = std::min(maze.getCols(), goal.col + radius + 1) - left;
+    
+    vector<double> V(rows * cols, 0.0);
+    double delta;
+    do{
+        delta = 0.0;
+        for(int r=0; r < rows; r++){
+            for(int c=0; c < cols; c++){
+                double pT = maze.isTrap(top + r, left + c) ? maze.getTrapProb() : 0.0;
+                double stay = pT * (rTrap + discount*V[r*cols + c]);
+                double best = -1e+10;
+                for(int a=0; a < 4; a++){
+                    int nr = r + dr[a];
+                    int nc = c + dc[a];
+                    double reward = rStep;
+                    if(!maze.validateState(State(top + nr, left + nc))){
+                        nr = r;
+                        nc = c;
+                        reward = rOut;
+                    }
+                    else if(nr < 0 || nr >= rows || nc < 0 || nc >= cols)
+                        continue; //Leaves the window
+                    if(goal.equals(top + nr, left + nc))
+                        reward = rGoal;
+                    best = std::max(best, stay + (1 - pT) * (reward + discount*V[nr*cols + nc]));
+                }
+                delta = std::max(delta, std::abs(best - V[r*cols + c]));
+                V[r*cols + c] = best;
+            }
+        }
+    }while(delta > error);
+    
+    return V[(goal.row - top) * cols + goal.col - left];
+}
+
+/*
+ * Gauss-Seidel value iteration on one level until no value changes by more than the error
+ */
+int Multigrid::Solve(const LEVEL& level, vector<double>& V){
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    int goal = level.goalRow * level.cols + level.goalCol;
+    double discount = level.discount;
+    double delta;
+    int iter = 0;
+
+    V[goal] = level.goalV;
+    do{
+        delta = 0.0;
+        for(int r=0; r < level.rows; r++){
+            for(int c=0; c < level.cols; c++){
+                int s = r * level.cols + c;
+                if(s == goal) continue;
+
+                double pT = level.trapP[s];
+                double stay = pT * (level.rTrap + discount*V[s]);
+                double best = -1e+10;
+                for(int a=0; a < 4; a++){
+                    int nr = r + dr[a];
+                    int nc = c + dc[a];
+                    double reward = level.rStep;
+                    if(nr < 0 || nr >= level.rows || nc < 0 || nc >= level.cols){
+                        nr = r;
+                        nc = c;
+                        reward = level.rOut;
+                    }
+                    double q = stay + (1 - pT) * (reward + discount*V[nr * level.cols + nc]);
+                    best = std::max(best, q);
+                }
+                delta = std::max(delta, std::abs(best - V[s]));
+                V[s] = best;
+            }
+        }
+        iter++;
+    }while(delta > error);
+
+    backups += (long)iter * level.rows * level.cols;
+    return iter;
+}
+
+/*
+ * Bilinear interpolation of the coarse values at the centers of the fine cells.  Centers outside the coarse grid are clamped to its border.
+ */
+void Multigrid::Interpolate(const LEVEL& coarse, const vector<double>& coarseV, const LEVEL& fine, vector<double>& fineV){
+    double ratio = (double)fine.block / coarse.block;
+
+    for(int r=0; r < fine.rows; r++){
+        double y = std::min(std::max((r + 0.5) * ratio - 0.5, 0.0), coarse.rows - 1.0);
+        int r0 = std::max(0, std::min((int)y, coarse.rows - 2));
+        int r1 = std::min(r0 + 1, coarse.rows - 1);
+        double wy = y - r0;
+
+        for(int c=0; c < fine.cols; c++){
+            double x = std::min(std::max((c + 0.5) * ratio - 0.5, 0.0), coarse.cols - 1.0);
+            int c0 = std::max(0, std::min((int)x, coarse.cols - 2));
+            int c1 = std::min(c0 + 1, coarse.cols - 1);
+            double wx = x - c0;
+
+            fineV[r * fine.cols + c] = (1 - wy) * ((1 - wx) * coarseV[r0 * coarse.cols + c0] + wx * coarseV[r0 * coarse.cols + c1])
+                                     + wy * ((1 - wx) * coarseV[r1 * coarse.cols + c0] + wx * coarseV[r1 * coarse.cols + c1]);
+        }
+    }
+}
+
+void Multigrid::WarmStart(const Maze& maze, double * V){
+    if(levels.empty()){
+        cout << "Maze is too small for a multigrid warm start." << endl;
+        return;
+    }
+
+    //Solve the coarsest level from scratch, then refine the interpolated values on every finer level
+    vector<double> coarseV(levels[0].rows * levels[0].cols, 0.0);
+    for(int l=0; l < levels.size(); l++){
+        if(l > 0){
+            vector<double> fineV(levels[l].rows * levels[l].cols);
+            Interpolate(levels[l-1], coarseV, levels[l], fineV);
+            coarseV.swap(fineV);
+        }
+        Solve(levels[l], coarseV);
+    }
+
+    //Interpolate into the fine maze and keep the values that are a lower bound
+    LEVEL fine;
+    fine.rows = maze.getRows();
+    fine.cols = maze.getCols();
+    fine.block = 1;
+    vector<double> fineV(fine.rows * fine.cols), L;
+    Interpolate(levels.back(), coarseV, fine, fineV);
+    LowerBound(maze, L);
+    for(int s=0; s < fineV.size(); s++)
+        fineV[s] = std::max(fineV[s], L[s]);
+    Monotone(maze, fineV, L);
+    std::copy(fineV.begin(), fineV.end(), V);
+}
+
+/*
+ * A free cell next to another free cell can move back and forth forever, with value rStep/(1-gamma).
+ * A trap cell next to a free cell can try to step out and then pace: L = (pT*rTrap + pE*(rStep + gamma*Lfree)) / (1 - pT*gamma).
+ * Every other cell gets the smallest reward forever.  Each value is the value of a policy that only moves to cells whose L is at least as large, so L <= TL.
+ */
+void Multigrid::LowerBound(const Maze& maze, vector<double>& L){
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    int rows = maze.getRows();
+    int cols = maze.getCols();
+    double rStep, rOut, rTrap, rGoal;
+    maze.getRewards(rStep, rOut, rTrap, rGoal);
+    double rMin = std::min(std::min(rStep, rOut), std::min(rTrap, rGoal));
+    double pT = maze.getTrapProb();
+    double pE = (float)(1 - pT); //As in Maze::expandMDP
+    double free = rStep / (1 - discount);
+    double trapped = (pT*rTrap + pE*(rStep + discount*free)) / (1 - pT*discount);
+
+    L.assign(rows * cols, rMin / (1 - discount));
+    for(int r=0; r < rows; r++){
+        for(int c=0; c < cols; c++){
+            bool freeNeighbour = false;
+            for(int a=0; a < 4; a++){
+                int nr = r + dr[a];
+                int nc = c + dc[a];
+                if(nr >= 0 && nr < rows && nc >= 0 && nc < cols && !maze.isTrap(nr, nc))
+                    freeNeighbour = true;
+            }
+            if(freeNeighbour)
+                L[r*cols + c] = maze.isTrap(r, c) ? trapped : free;
+        }
+    }
+}
+
+/*
+ * If V <= TV in every cell, V <= V* (the Bellman backup is monotone).  Cells whose backup is below V are reset to L; since lowering them can lower the backups of their neighbours, this repeats until no cell is reset.
+ */
+int Multigrid::Monotone(const Maze& maze, vector<double>& V, const vector<double>& L){
+    Stencil stencil(maze, discount);
+    int rows = maze.getRows();
+    int cols = maze.getCols();
+    int n = rows * cols;
+    bool lowered;
+    int iter = 0;
+    do{
+        //Alternate forward and backward passes, so that resets spread in every direction within a few passes
+        lowered = false;
+        for(int i=0; i < n; i++){
+            int s = (iter % 2 == 0) ? i : n - 1 - i;
+            if(V[s] > L[s] && stencil.Backup(V.data(), s / cols, s % cols) < V[s]){
+                V[s] = L[s];
+                lowered = true;
+            }
+        }
+        iter++;
+    }while(lowered);
+    
+    backups += (long)iter * rows * cols;
+    return iter;
+}
@@ -0,0 +1,55 @@
+/*
+ * Multigrid:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * Coarse-to-fine warm start for value iteration on large mazes.
+ *
+ * Level L aggregates the maze into blocks of factor^(L+1) x factor^(L+1) cells.  A coarse cell is trapped with the average trap probability of its block (trap density times p_traps), and one coarse move stands for as many fine moves as the block is wide, so the discount and the step, out and trap rewards are scaled accordingly.
+ * The goal block is absorbing, with the value of the fine goal cell (solved exactly in a small window around it).
+ * The coarsest level is solved from V = 0.  Its values are interpolated (bilinearly) to the next finer level, which is refined with VI, and so on until level 1 is interpolated to the fine maze.
+ * The interpolated values are only kept where they are a lower bound of V*: starting from max(L, interpolation), where L is the value of pacing between two cells forever, every cell whose backup would lower its value is reset to L until V <= TV holds everywhere.  Then V <= V*, and fine VI raises V monotonically.
+ * Cells that cannot reach the goal profitably have V* = L exactly, and from V = 0 they converge only at rate gamma, which dominates the no. of fine sweeps.
+ */
+
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include <vector>
+#include <iostream>
+#include "maze.h"
+
+using std::vector;
+
+class Multigrid{
+    private:
+        struct LEVEL{
+            int rows, cols;
+            int block; //Width of a coarse cell in fine cells
+            vector<float> trapP; //Prob. of getting trapped in each cell
+            int goalRow, goalCol;
+            double rStep, rOut, rTrap; //Rewards scaled to one coarse move
+            double goalV; //Value of the absorbing goal
+            double discount;
+        };
+
+        vector<LEVEL> levels; //levels[0] is the coarsest
+        double discount; //Of the fine maze
+        double error;
+        long backups; //Coarse cell backups, summed over all levels
+
+        double GoalValue(const Maze& maze, double discount); //Value of the goal, solved locally in the fine maze
+        LEVEL Aggregate(const Maze& maze, double discount, int block, double goalV); //Build the level with the given block width
+        int Solve(const LEVEL& level, vector<double>& V); //Gauss-Seidel VI on one level, returns the no. of sweeps
+        void Interpolate(const LEVEL& coarse, const vector<double>& coarseV, const LEVEL& fine, vector<double>& fineV); //Bilinear interpolation between cell centers
+        void LowerBound(const Maze& maze, vector<double>& L); //Value of pacing forever next to a free cell, a lower bound of V* that satisfies L <= TL
+        int Monotone(const Maze& maze, vector<double>& V, const vector<double>& L); //Reset cells with TV < V to L until V <= TV.  Returns the no. of passes
+
+    public:
+        Multigrid(const Maze& maze, double discount, double error, int factor = 2, int minSize = 8);
+
+        void WarmStart(const Maze& maze, double * V); //Solve all levels and write a lower bound of V* based on the interpolated values into the fine V
+        long getBackups() const { return backups; }
+        int getNumLevels() const { return levels.size(); }
+};
+
+#endif
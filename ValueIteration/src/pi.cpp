@@ -0,0 +1,142 @@
+#include "pi.h"
+
+PI::PI(VI_PARAMS& params, Maze * maze){
+    PlanParams = params;
+    this->maze = maze;
+    model = new SparseMDP(*maze);
+    numStates = model->getNumStates();
+    numActions = model->getNumActions();
+    backups = 0;
+
+    V = new double[numStates];
+    for(int i=0; i < numStates; i++) V[i] = 0.0;
+    policy.resize(numStates, 0);
+}
+
+PI::~PI(){
+    delete[] V;
+    delete model;
+}
+
+/*
+ * Policy iteration: evaluate the current policy until the error criteria is met, then improve it until it is stable
+ */
+void PI::Plan(){
+    double residual;
+    int iter = 0;
+    long sweeps = 0;
+    backups = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Improve(residual); //Start with the greedy policy w.r.t. V = 0
+    bool stable = false;
+    while(!stable){
+        double delta;
+        do{
+            delta = EvaluationSweep();
+            sweeps++;
+        }while(delta > PlanParams.error);
+
+        stable = Improve(residual);
+        iter++;
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    double time = std::chrono::duration<double, std::milli>(stop - start).count();
+    cout << "PI finished after " << iter << " policy improvements and " << sweeps << " evaluation sweeps in " << time << " ms." << endl;
+}
+
+/*
+ * Modified policy iteration: alternate one greedy backup of every state (which also improves the policy) with a fixed number of evaluation sweeps.
+ * With 0 evaluation sweeps this is plain value iteration.
+ */
+void PI::PlanModified(){
+    double residual;
+    int iter = 0;
+    long sweeps = 0;
+    backups = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    while(true){
+        Improve(residual, true);
+        iter++;
+        if(residual <= PlanParams.error) break;
+
+        for(int k=0; k < PlanParams.evalSweeps; k++){
+            EvaluationSweep();
+            sweeps++;
+        }
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    double time = std::chrono::duration<double, std::milli>(stop - start).count();
+    cout << "Modified PI (" << PlanParams.evalSweeps << " evaluation sweeps) finished after " << iter << " policy improvements and "
+         << sweeps << " evaluation sweeps in " << time << " ms." << endl;
+}
+
+/*
+ * Gauss-Seidel update of state s for the current policy:
+ * V(s) = sum_s' p(s')[r + gamma*V(s')], where V(s) may also appear on the right-hand side (self-loops) and is moved to the left.
+ */
+double PI::Evaluate(int s){
+    double discount = PlanParams.discount;
+    int a = policy[s];
+    double sum = 0.0;
+    double selfP = 0.0;
+
+    for(int t=model->begin(s, a); t < model->end(s, a); t++){
+        int s_p = model->getSuccessor(t);
+        double p = model->getProbability(t);
+        if(s_p == s){
+            selfP += p;
+            sum += p * model->getReward(t);
+        }
+        else
+            sum += p * (model->getReward(t) + discount*V[s_p]);
+    }
+    return sum / (1 - discount*selfP);
+}
+
+double PI::EvaluationSweep(){
+    double delta = 0.0;
+    for(int s=0; s < numStates; s++){
+        double v = Evaluate(s);
+        delta = std::max(delta, std::abs(v - V[s]));
+        V[s] = v;
+    }
+    backups += numStates;
+    return delta;
+}
+
+/*
+ * Greedy policy improvement.  The current action is only replaced by a strictly better one, so the policy cannot cycle between equally good actions.
+ * The residual is the Bellman residual max_s |max_a Q(s,a) - V(s)|.  If update is true, V is also set to the greedy values (in place).
+ */
+bool PI::Improve(double& residual, bool update){
+    double discount = PlanParams.discount;
+    bool stable = true;
+    residual = 0.0;
+
+    for(int s=0; s < numStates; s++){
+        double bestQ = model->Q(V, s, policy[s], discount);
+        int bestA = policy[s];
+        double currentQ = bestQ;
+
+        for(int a=0; a < numActions; a++){
+            double q = model->Q(V, s, a, discount);
+            if(q > bestQ){
+                bestQ = q;
+                bestA = a;
+            }
+        }
+
+        if(bestQ - currentQ > 1e-12 * std::max(1.0, std::abs(bestQ))){
+            policy[s] = bestA;
+            stable = false;
+        }
+        residual = std::max(residual, std::abs(bestQ - V[s]));
+        if(update) V[s] = bestQ;
+    }
+    backups += numStates;
+    return stable;
+}
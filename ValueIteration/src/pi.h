@@ -0,0 +1,54 @@
+/*
+ * PI:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * PI implements policy iteration and modified policy iteration over the compiled transition model.
+ *
+ * - Policy evaluation solves V = r_pi + gamma*P_pi*V with Gauss-Seidel sweeps.  Self-loops (e.g. traps) are on the diagonal of the system and are solved for directly instead of being iterated.
+ * - Policy iteration evaluates each policy until the update is below the error, and stops when the greedy policy no longer changes.
+ * - Modified policy iteration only performs a fixed number of evaluation sweeps per policy, and stops when the greedy backup changes no value by more than the error.
+ */
+
+#ifndef PI_H
+#define PI_H
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include "maze.h"
+#include "sparsemdp.h"
+#include "vi.h"
+
+using std::vector;
+using std::cout;
+using std::endl;
+
+class PI{
+    private:
+        VI_PARAMS PlanParams;
+        Maze * maze; //The planning domain
+        SparseMDP * model; //Compiled transition model
+        double * V; //Array for state values
+        vector<int> policy; //Current action in every state
+        int numStates;
+        int numActions;
+        long backups; //No. of state backups, including evaluation sweeps
+
+        double Evaluate(int s); //Solve the equation of state s for the current policy, using the current values of all other states
+        double EvaluationSweep(); //Gauss-Seidel sweep for the current policy, returns the max. update
+        bool Improve(double& residual, bool update = false); //Make the policy greedy w.r.t. V.  Returns true if it did not change
+
+    public:
+        PI(VI_PARAMS& PlanParams, Maze * maze);
+        ~PI();
+
+        void Plan(); //Policy iteration
+        void PlanModified(); //Modified policy iteration with PlanParams.evalSweeps sweeps per policy
+
+        const double * getValues() const { return V; }
+        const vector<int>& getPolicy() const { return policy; }
+        long getBackups() const { return backups; }
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "policyfile.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char Magic[8] = {'M', 'D', 'P', 'P', 'O', 'L', 'C', 'Y'};
+
+PolicyFile::PolicyFile(){
+    header = 0;
+    values = 0;
+    actions = 0;
+    data = 0;
+    size = 0;
+}
+
+PolicyFile::~PolicyFile(){
+    Close();
+}
+
+bool PolicyFile::Write(const std::string& file, int rows, int cols, double discount, double error, const double * V, const int8_t * policy){
+    size_t numStates = (size_t)rows * cols;
+
+    HEADER h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, Magic, sizeof(Magic));
+    h.version = Version;
+    h.headerSize = sizeof(HEADER);
+    h.rows = rows;
+    h.cols = cols;
+    h.discount = discount;
+    h.error = error;
+    h.valuesOffset = sizeof(HEADER);
+    h.actionsOffset = h.valuesOffset + numStates * sizeof(double);
+
+    //Pack four actions per byte
+    std::vector<uint8_t> packed((numStates + 3) / 4, 0);
+    for(size_t s=0; s < numStates; s++)
+        packed[s >> 2] |= (uint8_t)((policy[s] & 3) << (2*(s & 3)));
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if(!out.is_open()){
+        std::cerr << "Could not open file \"" << file << "\" for writing." << std::endl;
+        return false;
+    }
+    out.write((const char *)&h, sizeof(h));
+    out.write((const char *)V, numStates * sizeof(double));
+    out.write((const char *)packed.data(), packed.size());
+    out.close();
+
+    if(!out){
+        std::cerr << "Could not write policy file \"" << file << "\"." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool PolicyFile::Open(const std::string& file){
+    Close();
+
+    int fd = open(file.c_str(), O_RDONLY);
+    if(fd < 0){
+        std::cerr << "Could not open file \"" << file << "\"." << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(HEADER)){
+        std::cerr << "\"" << file << "\" is not a policy file." << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    size = st.st_size;
+    void * mapped = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); //The mapping remains valid
+    if(mapped == MAP_FAILED){
+        std::cerr << "Could not map file \"" << file << "\"." << std::endl;
+        size = 0;
+        return false;
+    }
+    data = mapped;
+    header = (const HEADER *)data;
+
+    //Validate the header and the size of the arrays
+    if(std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->headerSize != sizeof(HEADER)){
+        std::cerr << "\"" << file << "\" is not a policy file." << std::endl;
+        Close();
+        return false;
+    }
+    if(header->version != Version){
+        std::cerr << "Policy file \"" << file << "\" has version " << header->version << ", expected " << Version << "." << std::endl;
+        Close();
+        return false;
+    }
+
+    size_t numStates = (size_t)header->rows * header->cols;
+    if(header->rows <= 0 || header->cols <= 0 || header->valuesOffset % sizeof(double) != 0
+       || header->valuesOffset + numStates * sizeof(double) > header->actionsOffset
+       || header->actionsOffset + (numStates + 3) / 4 > size){
+        std::cerr << "Policy file \"" << file << "\" is truncated or corrupt." << std::endl;
+        Close();
+        return false;
+    }
+
+    values = (const double *)((const char *)data + header->valuesOffset);
+    actions = (const uint8_t *)data + header->actionsOffset;
+    return true;
+}
+
+void PolicyFile::Close(){
+    if(data) munmap(data, size);
+    header = 0;
+    values = 0;
+    actions = 0;
+    data = 0;
+    size = 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * PolicyFile:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * Binary storage of a solved grid MDP, so that other planners (e.g. UCT) can use the result of VI without solving again.
+ *
+ * Layout (native byte order):
+ * - A 64-byte header with a magic string, the format version, rows, cols, discount and error, and the offsets of the arrays below.
+ * - V as rows*cols doubles in row-major order, starting at byte 64.
+ * - The best action of every cell, packed in 2 bits (4 cells per byte).
+ *
+ * Open maps the file read-only, so loading takes constant time and the values and actions are used in place without copies.
+ * Only the pages actually accessed are read from disk.
+ */
+
+#ifndef POLICYFILE_H
+#define POLICYFILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+class PolicyFile{
+    private:
+        struct HEADER{
+            char magic[8]; //"MDPPOLCY"
+            uint32_t version;
+            uint32_t headerSize;
+            int32_t rows;
+            int32_t cols;
+            double discount;
+            double error;
+            uint64_t valuesOffset; //Byte offset of V
+            uint64_t actionsOffset; //Byte offset of the packed actions
+            uint8_t reserved[8];
+        };
+        static_assert(sizeof(HEADER) == 64, "Policy file header must be 64 bytes");
+
+        const HEADER * header;
+        const double * values;
+        const uint8_t * actions;
+        void * data; //Mapped file
+        size_t size; //Size of the mapping in bytes
+
+    public:
+        static const uint32_t Version = 1;
+
+        PolicyFile();
+        ~PolicyFile();
+
+        /*
+         * V and policy have rows*cols elements, and every action is in 0...3
+         */
+        static bool Write(const std::string& file, int rows, int cols, double discount, double error, const double * V, const int8_t * policy);
+
+        bool Open(const std::string& file); //Map a policy file read-only.  Returns false if it cannot be read or is not a valid policy file
+        void Close();
+
+        bool isOpen() const { return data != 0; }
+        int getRows() const { return header->rows; }
+        int getCols() const { return header->cols; }
+        double getDiscount() const { return header->discount; }
+        double getError() const { return header->error; }
+        const double * getValues() const { return values; }
+        double getValue(int r, int c) const { return values[(size_t)r*header->cols + c]; }
+        int getAction(int r, int c) const{
+            size_t s = (size_t)r*header->cols + c;
+            return (actions[s >> 2] >> (2*(s & 3))) & 3;
+        }
+};
+
+#endif
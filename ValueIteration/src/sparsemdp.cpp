@@ -0,0 +1,135 @@
+#include "sparsemdp.h"
+#include <chrono>
+#include <cassert>
+#include <algorithm>
+
+SparseMDP::SparseMDP(const Maze& maze){
+    numStates = maze.getNumStates();
+    numActions = maze.getNumActions();
+    cols = maze.getCols();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Compile(maze);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    buildTime = std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+SparseMDP::SparseMDP(const Maze& maze, const vector<int>& states){
+    numStates = states.size();
+    numActions = maze.getNumActions();
+    cols = maze.getCols();
+    stateIds = states;
+    localIndex.assign(maze.getNumStates(), -1);
+    for(int i=0; i < numStates; i++)
+        localIndex[states[i]] = i;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Compile(maze);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    buildTime = std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+/*
+ * Expand every state-action pair once and append its successors, rewards and probabilities to the tables
+ */
+void SparseMDP::Compile(const Maze& maze){
+    vector<State> states;
+    vector<int> actions;
+    vector<State> nextStates;
+    vector<double> reward;
+    vector<float> probability;
+    bool subset = !stateIds.empty();
+
+    if(subset){
+        for(int i=0; i < numStates; i++)
+            states.push_back(getState(i));
+    }
+    else
+        maze.listStates(states);
+    assert(states.size() == numStates);
+
+    offsets.resize(numStates*numActions + 1);
+    //Most transitions are deterministic; reserve one successor per pair and grow as needed
+    successors.reserve(numStates*numActions);
+    rewards.reserve(numStates*numActions);
+    probabilities.reserve(numStates*numActions);
+
+    for(State& s : states){
+        int index = getIndex(s);
+        maze.getActions(s, actions);
+        assert(actions.size() == numActions);
+
+        for(int a=0; a < numActions; a++){
+            offsets[index*numActions + a] = successors.size();
+            maze.expandMDP(s, actions[a], nextStates, reward, probability);
+
+            for(int s_p=0; s_p < nextStates.size(); s_p++){
+                if(subset && probability[s_p] == 0) continue;
+                assert(getIndex(nextStates[s_p]) >= 0);
+                successors.push_back(getIndex(nextStates[s_p]));
+                rewards.push_back(reward[s_p]);
+                probabilities.push_back(probability[s_p]);
+            }
+
+            //Free memory
+            nextStates.clear();
+            reward.clear();
+            probability.clear();
+        }
+        actions.clear();
+    }
+    offsets[numStates*numActions] = successors.size();
+
+    //Release unused capacity
+    successors.shrink_to_fit();
+    rewards.shrink_to_fit();
+    probabilities.shrink_to_fit();
+}
+
+size_t SparseMDP::getMemory() const{
+    return offsets.capacity() * sizeof(int)
+         + successors.capacity() * sizeof(int)
+         + rewards.capacity() * sizeof(double)
+         + probabilities.capacity() * sizeof(float)
+         + predecessorOffsets.capacity() * sizeof(int)
+         + predecessors.capacity() * sizeof(int)
+         + stateIds.capacity() * sizeof(int)
+         + localIndex.capacity() * sizeof(int);
+}
+
+/*
+ * Invert the transition table.  Each predecessor is listed once per successor, regardless of how many actions lead there.
+ */
+void SparseMDP::BuildPredecessors(){
+    if(hasPredecessors()) return;
+    
+    vector<int> next; //Distinct successors of the current state
+    vector<int> cursor; //Next free position for each successor
+    
+    predecessorOffsets.assign(numStates + 1, 0);
+    
+    //First pass counts, second pass fills
+    for(int pass=0; pass < 2; pass++){
+        for(int s=0; s < numStates; s++){
+            next.clear();
+            for(int t=offsets[s*numActions]; t < offsets[(s+1)*numActions]; t++){
+                int s_p = successors[t];
+                if(s_p != s && std::find(next.begin(), next.end(), s_p) == next.end())
+                    next.push_back(s_p);
+            }
+            for(int s_p : next){
+                if(pass == 0) predecessorOffsets[s_p+1]++;
+                else predecessors[cursor[s_p]++] = s;
+            }
+        }
+        
+        if(pass == 0){
+            for(int s=0; s < numStates; s++)
+                predecessorOffsets[s+1] += predecessorOffsets[s];
+            predecessors.resize(predecessorOffsets[numStates]);
+            cursor.assign(predecessorOffsets.begin(), predecessorOffsets.end() - 1);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * SparseMDP:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * A compiled, read-only copy of the transition model of an MDP in compressed sparse row (CSR) format.
+ *
+ * Maze::expandMDP is queried exactly once per state-action pair and its results are stored contiguously, so full-width planners can sweep the model without calling back into the problem or allocating memory.
+ * The transitions of pair (s,a) are stored at positions offsets[s*numActions + a] ... offsets[s*numActions + a + 1] - 1 of the successor, reward and probability arrays.
+ * States are indexed in row-major order, i.e. index = row * cols + col.
+ *
+ * A model may also be compiled over a subset of the states (e.g. those reachable from the start), provided it is closed under transitions with positive probability.  States are then numbered 0...n-1 in the order given, and transitions with probability 0 are dropped.
+ */
+
+#ifndef SPARSEMDP_H
+#define SPARSEMDP_H
+
+#define Infinity 1e+10
+
+#include <vector>
+#include <cstddef>
+#include "maze.h"
+
+using std::vector;
+
+class SparseMDP{
+    private:
+        int numStates;
+        int numActions;
+        int cols; //Used to convert between State and index
+        vector<int> offsets; //Row offsets for every (s,a) pair, plus one final entry
+        vector<int> successors; //Successor state indices
+        vector<double> rewards; //Reward of each transition
+        vector<float> probabilities; //Probability of each transition
+        vector<int> predecessorOffsets; //Reverse adjacency (CSR), built on demand
+        vector<int> predecessors;
+        vector<int> stateIds; //Maze state of each index, if compiled over a subset
+        vector<int> localIndex; //Index of each maze state (-1 if not included), if compiled over a subset
+        double buildTime; //Compilation time in ms
+
+        void Compile(const Maze& maze); //Query the maze and fill the tables
+
+    public:
+        SparseMDP(const Maze& maze);
+        SparseMDP(const Maze& maze, const vector<int>& states); //Compile only the given maze states (row-major indices)
+
+        /*
+         * Bellman backups
+         */
+        double Q(const double * V, int s, int a, double discount) const; //Sum over s' of p(s')[r + gamma*V(s')]
+        double Backup(const double * V, int s, double discount, int * action = 0) const; //max_a Q(s,a), optionally returning the best action
+
+        /*
+         * Utility functions
+         */
+        int getNumStates() const { return numStates; }
+        int getNumActions() const { return numActions; }
+        int getNumTransitions() const { return successors.size(); }
+        int getIndex(const State& s) const { return stateIds.empty() ? s.row * cols + s.col : localIndex[s.row * cols + s.col]; }
+        State getState(int index) const { int id = getStateId(index); return State(id / cols, id % cols); }
+        int getStateId(int index) const { return stateIds.empty() ? index : stateIds[index]; } //Row-major maze index of a state
+        double getBuildTime() const { return buildTime; }
+        size_t getMemory() const; //Memory used by the tables in bytes
+        
+        /*
+         * Predecessors: all states with at least one transition into s (excluding s itself)
+         */
+        void BuildPredecessors();
+        bool hasPredecessors() const { return !predecessorOffsets.empty(); }
+        int predBegin(int s) const { return predecessorOffsets[s]; }
+        int predEnd(int s) const { return predecessorOffsets[s+1]; }
+        int getPredecessor(int i) const { return predecessors[i]; }
+
+        //Direct access to the tables of pair (s,a)
+        int begin(int s, int a) const { return offsets[s*numActions + a]; }
+        int end(int s, int a) const { return offsets[s*numActions + a + 1]; }
+        int getSuccessor(int t) const { return successors[t]; }
+        double getReward(int t) const { return rewards[t]; }
+        float getProbability(int t) const { return probabilities[t]; }
+};
+
+/*
+ * Inline, since this is called for every state-action pair in every sweep.
+ * The sum is accumulated in the same order and precision as VI::Plan, so both produce identical values.
+ */
+inline double SparseMDP::Q(const double * V, int s, int a, double discount) const{
+    double sum_s_p = 0;
+    int last = offsets[s*numActions + a + 1];
+    for(int t = offsets[s*numActions + a]; t < last; t++){
+        sum_s_p += probabilities[t] * (rewards[t] + discount*V[successors[t]]);
+    }
+    return sum_s_p;
+}
+
+inline double SparseMDP::Backup(const double * V, int s, double discount, int * action) const{
+    double best_v = -Infinity;
+    for(int a=0; a < numActions; a++){
+        double q = Q(V, s, a, discount);
+        if(q > best_v){
+            best_v = q;
+            if(action) *action = a;
+        }
+    }
+    return best_v;
+}
+
+#endif
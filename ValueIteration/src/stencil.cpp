@@ -0,0 +1,217 @@
+#include "stencil.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STENCIL_X86
+#include <immintrin.h>
+#endif
+
+Stencil::Stencil(const Maze& maze, double discount){
+    rows = maze.getRows();
+    cols = maze.getCols();
+    words = (cols + 63) / 64;
+
+    //Pack the trap layout, one bit per cell
+    trapMask.resize(rows * words, 0);
+    for(int r=0; r < rows; r++)
+        for(int c=0; c < cols; c++)
+            if(maze.isTrap(r, c))
+                trapMask[r*words + c/64] |= (uint64_t)1 << (c%64);
+
+    goalRow = maze.getGoal().row;
+    goalCol = maze.getGoal().col;
+    terminalGoal = maze.isTerminal(maze.getGoal());
+    maze.getRewards(rStep, rOut, rTrap, rGoal);
+
+    //Maze::expandMDP stores probabilities as float
+    pTrap = maze.getTrapProb();
+    pEscape = (float)(1 - pTrap);
+    this->discount = discount;
+
+    setAVX2(true);
+}
+
+void Stencil::Update(const Maze& maze, const vector<State>& cells){
+    for(const State& s : cells){
+        uint64_t bit = (uint64_t)1 << (s.col%64);
+        if(maze.isTrap(s.row, s.col))
+            trapMask[s.row*words + s.col/64] |= bit;
+        else
+            trapMask[s.row*words + s.col/64] &= ~bit;
+    }
+    goalRow = maze.getGoal().row;
+    goalCol = maze.getGoal().col;
+    terminalGoal = maze.isTerminal(maze.getGoal());
+}
+
+void Stencil::setRewards(double rStep, double rOut, double rTrap, double rGoal, double discount){
+    this->rStep = rStep;
+    this->rOut = rOut;
+    this->rTrap = rTrap;
+    this->rGoal = rGoal;
+    this->discount = discount;
+}
+
+void Stencil::setAVX2(bool enable){
+#ifdef STENCIL_X86
+    avx2 = enable && __builtin_cpu_supports("avx2");
+#else
+    avx2 = false;
+#endif
+}
+
+uint64_t Stencil::trapBits(int r, int c) const{
+    int w = c/64;
+    int o = c%64;
+    uint64_t bits = trapMask[r*words + w] >> o;
+    if(o > 60 && w+1 < words)
+        bits |= trapMask[r*words + w + 1] << (64 - o);
+    return bits & 0xF;
+}
+
+#ifdef STENCIL_X86
+/*
+ * Load four consecutive values as doubles
+ */
+__attribute__((target("avx2")))
+static inline __m256d load4(const double * p){
+    return _mm256_loadu_pd(p);
+}
+
+__attribute__((target("avx2")))
+static inline __m256d load4(const float * p){
+    return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d load4(const BFloat16 * p){
+    //Widen to float by placing the 16 bits in the upper half of each 32-bit lane
+    __m128i half = _mm_loadl_epi64((const __m128i *)p);
+    return _mm256_cvtps_pd(_mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), half)));
+}
+
+/*
+ * AVX2 kernel: four cells per iteration.  The trap bits are expanded into lane masks and the max is taken with vmaxpd, so there are no branches per cell.
+ */
+template<typename T>
+__attribute__((target("avx2")))
+double Stencil::BackupRowAVX2(const T * V, double * out, int r) const{
+    const T * row = V + r*cols;
+    const T * up = (r > 0) ? row - cols : row;
+    const T * down = (r < rows-1) ? row + cols : row;
+
+    const __m256d gamma = _mm256_set1_pd(discount);
+    const __m256d stepR = _mm256_set1_pd(rStep);
+    const __m256d upR = _mm256_set1_pd((r > 0) ? rStep : rOut);
+    const __m256d downR = _mm256_set1_pd((r < rows-1) ? rStep : rOut);
+    const __m256d trapR = _mm256_set1_pd(rTrap);
+    const __m256d trapP = _mm256_set1_pd(pTrap);
+    const __m256d escapeP = _mm256_set1_pd(pEscape);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256i lanes = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256d residual = _mm256_setzero_pd();
+
+    int c = 1;
+    for(; c + 4 <= cols - 1; c += 4){
+        __m256i bits = _mm256_set1_epi64x(trapBits(r, c));
+        __m256d trapped = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(bits, lanes), lanes));
+        __m256d pT = _mm256_and_pd(trapped, trapP);
+        __m256d pE = _mm256_blendv_pd(one, escapeP, trapped);
+
+        __m256d v = load4(row + c);
+        __m256d stay = _mm256_mul_pd(pT, _mm256_add_pd(trapR, _mm256_mul_pd(gamma, v)));
+        __m256d qU = _mm256_add_pd(stay, _mm256_mul_pd(pE, _mm256_add_pd(upR, _mm256_mul_pd(gamma, load4(up + c)))));
+        __m256d qD = _mm256_add_pd(stay, _mm256_mul_pd(pE, _mm256_add_pd(downR, _mm256_mul_pd(gamma, load4(down + c)))));
+        __m256d qL = _mm256_add_pd(stay, _mm256_mul_pd(pE, _mm256_add_pd(stepR, _mm256_mul_pd(gamma, load4(row + c - 1)))));
+        __m256d qR = _mm256_add_pd(stay, _mm256_mul_pd(pE, _mm256_add_pd(stepR, _mm256_mul_pd(gamma, load4(row + c + 1)))));
+
+        __m256d q = _mm256_max_pd(_mm256_max_pd(qU, qD), _mm256_max_pd(qL, qR));
+        _mm256_storeu_pd(out + c, q);
+        residual = _mm256_max_pd(residual, _mm256_andnot_pd(sign, _mm256_sub_pd(q, v)));
+    }
+
+    //Horizontal max
+    __m128d half = _mm_max_pd(_mm256_castpd256_pd128(residual), _mm256_extractf128_pd(residual, 1));
+    half = _mm_max_sd(half, _mm_unpackhi_pd(half, half));
+    double result = _mm_cvtsd_f64(half);
+
+    //Remaining cells
+    return std::max(result, BackupRange(V, out, r, c, cols - 1));
+}
+#else
+template<typename T>
+double Stencil::BackupRowAVX2(const T * V, double * out, int r) const{
+    return BackupRange(V, out, r, 1, cols - 1);
+}
+#endif
+
+/*
+ * The kernels cover the interior of the row.  The first and last column, and the cells from which an action reaches the goal, are backed up by FixRow.
+ */
+template<typename T>
+double Stencil::BackupRowAny(const T * V, double * out, int r) const{
+    double residual = 0.0;
+    if(cols > 2)
+        residual = avx2 ? BackupRowAVX2(V, out, r) : BackupRange(V, out, r, 1, cols - 1);
+    residual = std::max(residual, FixRow(V, out, r));
+    
+    //The kernel residual included the cells next to the goal, which FixRow has replaced
+    if(std::abs(r - goalRow) <= 1){
+        const T * row = V + r*cols;
+        residual = 0.0;
+        for(int c=0; c < cols; c++)
+            residual = std::max(residual, std::abs(out[c] - (double)row[c]));
+    }
+    return residual;
+}
+
+double Stencil::BackupRow(const double * V, double * out, int r) const{
+    return BackupRowAny(V, out, r);
+}
+
+double Stencil::BackupRow(const float * V, double * out, int r) const{
+    return BackupRowAny(V, out, r);
+}
+
+double Stencil::BackupRow(const BFloat16 * V, double * out, int r) const{
+    return BackupRowAny(V, out, r);
+}
+
+/*
+ * Back up every row of V with both kernels and compare to the same backup computed through Maze::expandMDP
+ */
+double Stencil::Verify(const Maze& maze, const double * V){
+    vector<double> out(cols);
+    vector<State> nextStates;
+    vector<double> reward;
+    vector<float> probability;
+    double maxDiff = 0.0;
+    bool useAVX2 = avx2;
+
+    for(int kernel=0; kernel < 2; kernel++){
+        setAVX2(kernel == 0);
+        for(int r=0; r < rows; r++){
+            BackupRow(V, out.data(), r);
+            for(int c=0; c < cols; c++){
+                double best = -Infinity;
+                for(int a=0; a < maze.getNumActions(); a++){
+                    maze.expandMDP(State(r, c), a, nextStates, reward, probability);
+                    double sum_s_p = 0;
+                    for(int s_p=0; s_p < nextStates.size(); s_p++)
+                        sum_s_p += probability[s_p] * (reward[s_p] + discount*V[nextStates[s_p].row*cols + nextStates[s_p].col]);
+                    best = std::max(best, sum_s_p);
+
+                    nextStates.clear();
+                    reward.clear();
+                    probability.clear();
+                }
+                maxDiff = std::max(maxDiff, std::abs(out[c] - best));
+            }
+        }
+    }
+
+    setAVX2(useAVX2);
+    return maxDiff;
+}
@@ -0,0 +1,163 @@
+/*
+ * Stencil:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * Specialised Bellman backup for the grid structure of the Maze.
+ *
+ * Every action moves to one of the four neighbours (or stays put at the border) and trap cells add one self-loop, so the backup of a cell only needs V at the cell and its neighbours plus one trap bit.
+ * BackupRow computes the four action values of a whole row at once, using AVX2 when the processor supports it and a portable scalar loop otherwise.  Both produce the same values as a backup through Maze::expandMDP.
+ * The portable kernels are templates over the type of V, so values may also be stored in lower precision.  Backups are always accumulated in double.
+ */
+
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#define Infinity 1e+10
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "maze.h"
+#include "bfloat16.h"
+
+using std::vector;
+
+class Stencil{
+    private:
+        int rows, cols;
+        int words; //64-bit words per row of the trap mask
+        vector<uint64_t> trapMask; //Packed trap mask, one bit per cell
+        int goalRow, goalCol;
+        bool terminalGoal; //Goal is absorbing (Maze::isTerminal)
+        double rStep, rOut, rTrap, rGoal;
+        double pTrap, pEscape; //Probabilities of staying trapped/escaping, rounded like Maze::expandMDP
+        double discount;
+        bool avx2; //Use the AVX2 kernel
+
+        uint64_t trapBits(int r, int c) const; //Trap bits of cells c...c+3 in row r
+        template<typename T> double BackupRange(const T * V, double * out, int r, int first, int last) const; //Portable kernel for interior cells first...last-1
+        template<typename T> double BackupRowAVX2(const T * V, double * out, int r) const; //AVX2 kernel for all interior cells
+        template<typename T> double BackupRowAny(const T * V, double * out, int r) const; //Select the kernel and fix the remaining cells
+        template<typename T> double FixRow(const T * V, double * out, int r) const; //Scalar backups for the border columns and the goal and its neighbours
+
+    public:
+        Stencil(const Maze& maze, double discount);
+
+        template<typename T> double Q(const T * V, int r, int c, int a) const; //Value of action a in cell (r,c)
+        template<typename T> double Backup(const T * V, int r, int c, int * action = 0) const; //Scalar backup of a single cell, optionally returning the best action
+        double BackupRow(const double * V, double * out, int r) const; //Back up row r of V into out[0...cols-1] and return the max. residual
+        double BackupRow(const float * V, double * out, int r) const;
+        double BackupRow(const BFloat16 * V, double * out, int r) const;
+        double Verify(const Maze& maze, const double * V); //Max. difference between the kernels and expandMDP backups of V
+        void Update(const Maze& maze, const vector<State>& cells); //Re-read the trap bits of the given cells and the goal after the maze was edited
+        void setRewards(double rStep, double rOut, double rTrap, double rGoal, double discount); //Use other rewards and discount than the maze (see BatchVI)
+
+        int getRows() const { return rows; }
+        int getCols() const { return cols; }
+        size_t getMemory() const { return trapMask.size() * sizeof(uint64_t); }
+        bool isTrap(int r, int c) const { return (trapMask[r*words + c/64] >> (c%64)) & 1; }
+        bool hasAVX2() const { return avx2; }
+        void setAVX2(bool enable); //Select kernel (AVX2 is only enabled if supported)
+};
+
+/*
+ * Value of action a in cell (r,c), including the border and goal cases.
+ * Outcomes are summed in the same order as expandMDP: first the trap self-loop, then the action.
+ */
+template<typename T>
+double Stencil::Q(const T * V, int r, int c, int a) const{
+    //UP, DOWN, LEFT, RIGHT
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    if(terminalGoal && r == goalRow && c == goalCol)
+        return discount*(double)V[r*cols + c]; //Absorbing goal, no reward
+    bool trapped = isTrap(r, c);
+    double pE = trapped ? pEscape : 1.0;
+    double stay = trapped ? pTrap * (rTrap + discount*(double)V[r*cols + c]) : 0.0;
+
+    int nr = r + dr[a];
+    int nc = c + dc[a];
+    double reward = rStep;
+    if(nr < 0 || nr >= rows || nc < 0 || nc >= cols){
+        nr = r;
+        nc = c;
+        reward = rOut;
+    }
+    if(nr == goalRow && nc == goalCol)
+        reward = rGoal;
+
+    return stay + pE * (reward + discount*(double)V[nr*cols + nc]);
+}
+
+/*
+ * Back up a single cell
+ */
+template<typename T>
+double Stencil::Backup(const T * V, int r, int c, int * action) const{
+    double best = -Infinity;
+    for(int a=0; a < 4; a++){
+        double q = Q(V, r, c, a);
+        if(q > best){
+            best = q;
+            if(action) *action = a;
+        }
+    }
+    return best;
+}
+
+/*
+ * Portable kernel.  Valid for columns 1...cols-2 and cells not adjacent to the goal, where left/right moves always succeed with rStep.
+ * Non-trap cells use pT = 0 and pE = 1, which gives exactly the same value as the single outcome of expandMDP.
+ */
+template<typename T>
+double Stencil::BackupRange(const T * V, double * out, int r, int first, int last) const{
+    const T * row = V + r*cols;
+    const T * up = (r > 0) ? row - cols : row;
+    const T * down = (r < rows-1) ? row + cols : row;
+    double rUp = (r > 0) ? rStep : rOut;
+    double rDown = (r < rows-1) ? rStep : rOut;
+    double residual = 0.0;
+
+    for(int c=first; c < last; c++){
+        bool trapped = (trapMask[r*words + c/64] >> (c%64)) & 1;
+        double pT = trapped ? pTrap : 0.0;
+        double pE = trapped ? pEscape : 1.0;
+        double v = row[c];
+
+        double stay = pT * (rTrap + discount*v);
+        double qU = stay + pE * (rUp + discount*(double)up[c]);
+        double qD = stay + pE * (rDown + discount*(double)down[c]);
+        double qL = stay + pE * (rStep + discount*(double)row[c-1]);
+        double qR = stay + pE * (rStep + discount*(double)row[c+1]);
+
+        double q = std::max(std::max(qU, qD), std::max(qL, qR));
+        out[c] = q;
+        residual = std::max(residual, std::abs(q - v));
+    }
+    return residual;
+}
+
+/*
+ * Returns the residual of the border cells only
+ */
+template<typename T>
+double Stencil::FixRow(const T * V, double * out, int r) const{
+    const T * row = V + r*cols;
+    double residual = 0.0;
+
+    out[0] = Backup(V, r, 0);
+    residual = std::abs(out[0] - (double)row[0]);
+    if(cols > 1){
+        out[cols-1] = Backup(V, r, cols-1);
+        residual = std::max(residual, std::abs(out[cols-1] - (double)row[cols-1]));
+    }
+
+    if(std::abs(r - goalRow) <= 1){
+        for(int c = std::max(0, goalCol-1); c <= std::min(cols-1, goalCol+1); c++)
+            out[c] = Backup(V, r, c);
+    }
+    return residual;
+}
+
+#endif
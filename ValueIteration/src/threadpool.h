@@ -0,0 +1,91 @@
+/*
+ * ThreadPool:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * A minimal pool of persistent worker threads for data-parallel planning.
+ * Run(task) executes task(id) once on every thread, with id = 0...numThreads-1, and returns when all of them have finished.  The calling thread takes id 0, so a pool of size 1 runs everything sequentially.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool{
+    private:
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable start, done;
+        const std::function<void(int)> * task; //Current task, shared by all workers
+        int generation; //Incremented for every new task
+        int pending; //Workers that have not finished the current task
+        bool stop;
+
+        void Work(int id);
+
+    public:
+        ThreadPool(int numThreads);
+        ~ThreadPool();
+
+        int getNumThreads() const { return workers.size() + 1; }
+        void Run(const std::function<void(int)>& task);
+};
+
+inline ThreadPool::ThreadPool(int numThreads){
+    task = 0;
+    generation = 0;
+    pending = 0;
+    stop = false;
+    for(int id=1; id < numThreads; id++)
+        workers.push_back(std::thread(&ThreadPool::Work, this, id));
+}
+
+inline ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    start.notify_all();
+    for(std::thread& t : workers) t.join();
+}
+
+inline void ThreadPool::Run(const std::function<void(int)>& task){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        this->task = &task;
+        pending = workers.size();
+        generation++;
+    }
+    start.notify_all();
+
+    task(0);
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this]{ return pending == 0; });
+    this->task = 0;
+}
+
+inline void ThreadPool::Work(int id){
+    int seen = 0;
+    while(true){
+        const std::function<void(int)> * current;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            start.wait(guard, [this, seen]{ return stop || generation != seen; });
+            if(stop) return;
+            seen = generation;
+            current = task;
+        }
+
+        (*current)(id);
+
+        std::lock_guard<std::mutex> guard(lock);
+        if(--pending == 0) done.notify_one();
+    }
+}
+
+#endif
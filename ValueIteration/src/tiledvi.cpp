@@ -0,0 +1,289 @@
+#include "tiledvi.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define Infinity 1e+10
+
+using std::cout;
+using std::endl;
+
+/*
+ * Bytes read from and written to storage by this process so far (Linux only, 0 otherwise)
+ */
+static void StorageIO(double& read, double& written){
+    read = written = 0;
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    double value;
+    while(io >> key >> value){
+        if(key == "read_bytes:") read = value;
+        else if(key == "write_bytes:") written = value;
+    }
+}
+
+TiledVI::TiledVI(PARAMS& params, float discount, int tile){
+    assert(!params.terminalGoal); //The tile backup has no absorbing goal
+    rows = params.rows;
+    cols = params.cols;
+    traps = params.traps;
+    this->tile = std::max(8, (tile + 7) / 8 * 8); //Whole bytes of trap bits per tile row
+    tileRows = (rows + this->tile - 1) / this->tile;
+    tileCols = (cols + this->tile - 1) / this->tile;
+    tileCells = (size_t)this->tile * this->tile;
+
+    goalRow = params.goal->row;
+    goalCol = params.goal->col;
+    rStep = params.rStep;
+    rOut = params.rOut;
+    rTrap = params.rTrap;
+    rGoal = params.rGoal;
+    pTrap = params.p_traps;
+    pEscape = (float)(1 - params.p_traps);
+    this->discount = discount;
+
+    data = 0;
+    size = 0;
+    trapMask = 0;
+    values = 0;
+    iter = 0;
+    backups = 0;
+    bytes = 0;
+}
+
+TiledVI::~TiledVI(){
+    Close();
+}
+
+bool TiledVI::Open(const std::string& file){
+    Close();
+
+    size_t numTiles = (size_t)tileRows * tileCols;
+    size_t maskBytes = numTiles * ((tileCells + 63) / 64) * sizeof(uint64_t);
+    size = maskBytes + numTiles * tileCells * sizeof(double);
+
+    int fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        std::cerr << "Could not create tile store \"" << file << "\"." << endl;
+        return false;
+    }
+    //The file is sparse and reads as zeros, i.e. no traps and V = 0
+    if(ftruncate(fd, size) != 0){
+        std::cerr << "Could not allocate " << size << " bytes for tile store \"" << file << "\"." << endl;
+        ::close(fd);
+        unlink(file.c_str());
+        return false;
+    }
+    void * mapped = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED){
+        std::cerr << "Could not map tile store \"" << file << "\"." << endl;
+        unlink(file.c_str());
+        return false;
+    }
+
+    path = file;
+    data = (char *)mapped;
+    trapMask = (uint64_t *)data;
+    values = (double *)(data + maskBytes);
+    Generate();
+    return true;
+}
+
+void TiledVI::Close(){
+    if(data){
+        munmap(data, size);
+        unlink(path.c_str());
+    }
+    data = 0;
+    trapMask = 0;
+    values = 0;
+}
+
+size_t TiledVI::index(int r, int c) const{
+    size_t t = (size_t)(r / tile) * tileCols + c / tile;
+    return t * tileCells + (size_t)(r % tile) * tile + c % tile;
+}
+
+bool TiledVI::isTrap(int r, int c) const{
+    size_t i = index(r, c);
+    return (trapMask[i / 64] >> (i % 64)) & 1;
+}
+
+/*
+ * Same sequence of random numbers as Maze::InitMaze.  The goal is never trapped.
+ */
+void TiledVI::Generate(){
+    srand(0);
+    int traps_placed = 0;
+    while(traps_placed < traps){
+        int c = rand() % cols;
+        int r = rand() % rows;
+        if(!isTrap(r, c) && !(r == goalRow && c == goalCol)){
+            size_t i = index(r, c);
+            trapMask[i / 64] |= (uint64_t)1 << (i % 64);
+            traps_placed++;
+        }
+    }
+}
+
+/*
+ * Backup of cell (r,c), whose value is at v in the buffer, including the border and goal cases.
+ * Outcomes are summed in the same order as Maze::expandMDP: first the trap self-loop, then the action.
+ */
+double TiledVI::Backup(const double * v, int r, int c, bool trapped) const{
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    int stride = tile + 2;
+    double pE = trapped ? pEscape : 1.0;
+    double stay = trapped ? pTrap * (rTrap + discount*(*v)) : 0.0;
+    double best = -Infinity;
+
+    for(int a=0; a < 4; a++){
+        int nr = r + dr[a];
+        int nc = c + dc[a];
+        double reward = rStep;
+        double next;
+        if(nr < 0 || nr >= rows || nc < 0 || nc >= cols){
+            nr = r;
+            nc = c;
+            reward = rOut;
+            next = *v;
+        }
+        else
+            next = v[dr[a]*stride + dc[a]];
+        if(nr == goalRow && nc == goalCol)
+            reward = rGoal;
+
+        best = std::max(best, stay + pE * (reward + discount*next));
+    }
+    return best;
+}
+
+/*
+ * Copy tile (tr,tc) and its halo into the buffer, perform one pass over the tile and write it back.
+ * As in VI::PlanStencil, rows are updated in place but the cells of a row are backed up simultaneously, which avoids a dependency between consecutive cells.
+ * A neighbour is activated if the cells next to it changed by more than the error.
+ */
+double TiledVI::Sweep(int tr, int tc, double error){
+    int r0 = tr * tile;
+    int c0 = tc * tile;
+    int h = std::min(tile, rows - r0);
+    int w = std::min(tile, cols - c0);
+    int stride = tile + 2;
+    double * b = buffer.data();
+    double * row = b + (size_t)stride * stride; //Backed up values of the current row
+
+    //Load tile and halo
+    for(int i=-1; i <= h; i++){
+        int r = r0 + i;
+        if(r < 0 || r >= rows) continue;
+        const double * src = values + index(r, c0);
+        std::copy(src, src + w, b + (i+1)*stride + 1);
+        if(i >= 0 && i < h){
+            if(c0 > 0) b[(i+1)*stride] = values[index(r, c0-1)];
+            if(c0 + w < cols) b[(i+1)*stride + w + 1] = values[index(r, c0+w)];
+        }
+    }
+    bytes += (double)(h + 2) * (w + 2) * sizeof(double) + (double)h * w / 8;
+
+    double delta = 0.0;
+    double edge[4] = {0.0, 0.0, 0.0, 0.0}; //Max. change in the first/last row and column
+    size_t base = ((size_t)tr*tileCols + tc) * tileCells;
+    for(int i=0; i < h; i++){
+        int r = r0 + i;
+        double * v = b + (i+1)*stride + 1;
+        const size_t k = base + (size_t)i*tile;
+
+        //Cells away from the border and the goal, where every action moves with rStep
+        int first = 0, last = 0;
+        if(r > 0 && r < rows-1 && std::abs(r - goalRow) > 1){
+            first = (c0 == 0) ? 1 : 0;
+            last = (c0 + w == cols) ? w-1 : w;
+        }
+        for(int j=first; j < last; j++){
+            bool trapped = (trapMask[(k + j) / 64] >> ((k + j) % 64)) & 1;
+            double pT = trapped ? pTrap : 0.0;
+            double pE = trapped ? pEscape : 1.0;
+            double next = std::max(std::max(v[j-stride], v[j+stride]), std::max(v[j-1], v[j+1]));
+            row[j] = pT * (rTrap + discount*v[j]) + pE * (rStep + discount*next);
+        }
+        for(int j=0; j < w; j++){
+            if(j == first && last > first) j = last;
+            if(j < w) row[j] = Backup(v + j, r, c0 + j, (trapMask[(k + j) / 64] >> ((k + j) % 64)) & 1);
+        }
+
+        for(int j=0; j < w; j++){
+            double change = std::abs(row[j] - v[j]);
+            delta = std::max(delta, change);
+            if(i == 0) edge[0] = std::max(edge[0], change);
+            if(i == h-1) edge[1] = std::max(edge[1], change);
+        }
+        edge[2] = std::max(edge[2], std::abs(row[0] - v[0]));
+        edge[3] = std::max(edge[3], std::abs(row[w-1] - v[w-1]));
+        std::copy(row, row + w, v);
+    }
+    backups += (long)h * w;
+
+    //Write back
+    for(int i=0; i < h; i++){
+        const double * src = b + (i+1)*stride + 1;
+        std::copy(src, src + w, values + index(r0 + i, c0));
+    }
+    bytes += (double)h * w * sizeof(double);
+
+    if(delta > error) active[tr*tileCols + tc] = 1;
+    if(edge[0] > error && tr > 0) active[(tr-1)*tileCols + tc] = 1;
+    if(edge[1] > error && tr < tileRows-1) active[(tr+1)*tileCols + tc] = 1;
+    if(edge[2] > error && tc > 0) active[tr*tileCols + tc - 1] = 1;
+    if(edge[3] > error && tc < tileCols-1) active[tr*tileCols + tc + 1] = 1;
+    return delta;
+}
+
+/*
+ * Sweep the active tiles until none is left, then verify with a sweep over all tiles
+ */
+void TiledVI::Plan(double error){
+    active.assign((size_t)tileRows * tileCols, 1);
+    buffer.assign((size_t)(tile + 2) * (tile + 3), 0.0);
+    iter = 0;
+    backups = 0;
+    bytes = 0;
+
+    double read0, written0, read1, written1;
+    StorageIO(read0, written0);
+    auto start = std::chrono::high_resolution_clock::now();
+    bool verify = false;
+    while(true){
+        double delta = 0.0;
+        for(int tr=0; tr < tileRows; tr++){
+            for(int tc=0; tc < tileCols; tc++){
+                char& a = active[tr*tileCols + tc];
+                if(!a && !verify) continue;
+                a = 0;
+                delta = std::max(delta, Sweep(tr, tc, error));
+            }
+        }
+        iter++;
+        if(verify && delta <= error) break;
+
+        verify = std::find(active.begin(), active.end(), 1) == active.end();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    StorageIO(read1, written1);
+
+    double time = std::chrono::duration<double, std::milli>(stop - start).count();
+    double numStates = (double)rows * cols;
+    cout << "Tiled VI (" << tileRows << "x" << tileCols << " tiles of " << tile << "x" << tile << ", store " << size / 1e9 << " GB) finished after "
+         << iter << " sweeps and " << backups / numStates << " backups per state in " << time << " ms." << endl;
+    cout << "Store traffic: " << bytes / 1e9 << " GB (" << bytes / iter / 1e9 << " GB per sweep), storage I/O: "
+         << (read1 - read0) / 1e9 << " GB read, " << (written1 - written0) / 1e9 << " GB written" << endl;
+}
@@ -0,0 +1,72 @@
+/*
+ * TiledVI:
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021)
+ *
+ * Out-of-core value iteration for mazes that do not fit in memory.
+ *
+ * The trap layout and V are kept in a file-backed store (mmap), split into square tiles of tile x tile cells.  Each tile is stored contiguously, so sweeping a tile touches one contiguous block of the file.
+ * The maze is generated directly into the store with the same random sequence as Maze::InitMaze, so no Maze (and no char** grid) is needed and the results match the in-memory planners.
+ *
+ * A tile is copied into a buffer together with a one-cell halo of its neighbours, backed up (Gauss-Seidel within the tile) and written back.  Only active tiles are swept: a tile stays active while its values change by more than the error, and activates the neighbours whose halo it changed.
+ * When no tile is active, a verification sweep over all tiles checks the error criteria.
+ */
+
+#ifndef TILEDVI_H
+#define TILEDVI_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "maze.h"
+
+using std::vector;
+
+class TiledVI{
+    private:
+        int rows, cols;
+        int traps; //No. of traps
+        int tile; //Width of a tile in cells
+        int tileRows, tileCols; //No. of tiles in each direction
+        size_t tileCells; //Cells per tile (tile*tile, also for the partial tiles at the border)
+        int goalRow, goalCol;
+        double rStep, rOut, rTrap, rGoal;
+        double pTrap, pEscape; //Probabilities of staying trapped/escaping, rounded like Maze::expandMDP
+        double discount;
+
+        std::string path; //Backing file, removed by Close
+        char * data; //Mapped store
+        size_t size; //Size of the store in bytes
+        uint64_t * trapMask; //Packed trap bits, one block of tileCells/64 words per tile
+        double * values; //V, one block of tileCells doubles per tile
+
+        vector<char> active; //Tiles to sweep
+        vector<double> buffer; //Tile plus halo, (tile+2)^2 cells, and one row of backed up values
+        int iter; //No. of sweeps
+        long backups; //No. of cell backups
+        double bytes; //Store bytes read and written by the sweeps
+
+        size_t index(int r, int c) const; //Position of cell (r,c) in the store
+        bool isTrap(int r, int c) const;
+        double Backup(const double * v, int r, int c, bool trapped) const; //Backup of a cell in the buffer (any position)
+        void Generate(); //Place goal and traps like Maze::InitMaze
+        double Sweep(int tr, int tc, double error); //Back up tile (tr,tc) and activate neighbours.  Returns the max. change
+
+    public:
+        TiledVI(PARAMS& params, float discount, int tile = 256);
+        ~TiledVI();
+
+        bool Open(const std::string& file); //Create the store and generate the maze.  Returns false if the store cannot be created
+        void Close();
+
+        void Plan(double error); //VI until no value changes by more than error
+
+        double getValue(int r, int c) const { return values[index(r, c)]; }
+        int getRows() const { return rows; }
+        int getCols() const { return cols; }
+        size_t getStoreSize() const { return size; }
+        int getIterations() const { return iter; }
+        long getBackups() const { return backups; }
+};
+
+#endif
@@ -4,14 +4,27 @@ using std::cout;
 using std::endl;
 
 VI::VI(VI_PARAMS& params, Maze * maze){
-    PlanParams.discount = params.discount;
-    PlanParams.error = params.error;
+    PlanParams = params;
     this->maze = maze;
     numActions = maze->getNumActions();    
     numStates = maze->getRows()*maze->getCols();
     
     V = new double[numStates];
     for(int i=0; i < numStates; i++) V[i] = 0.0;
+    
+    model = 0;
+    stencil = 0;
+    backups = 0;
+    warmBackups = 0;
+    greedy.resize(numStates, 0);
+    if(PlanParams.storeQ) Qtable.resize((size_t)numStates * numActions, 0.0);
+    policyValid = false;
+}
+
+VI::~VI(){
+    delete[] V;
+    delete model;
+    delete stencil;
 }
 
 /*
@@ -22,7 +35,8 @@ void VI::Plan(){
 }
 
 /*
- * Perform value iteration with given error
+ * Perform value iteration with given error.
+ * The greedy action (and the Q-values) of every state are recorded during the sweeps, so after the final sweep they need not be computed again.
  */
 void VI::Plan(double error){    
     double previousV;
@@ -67,6 +81,12 @@ void VI::Plan(double error){
                 probability.clear();
             }
 
+            //Record the greedy action and Q-values
+            int index = s.row * maze->getCols() + s.col;
+            greedy[index] = actions[arg_max(outcomes)];
+            if(PlanParams.storeQ)
+                std::copy(outcomes.begin(), outcomes.end(), Qtable.begin() + (size_t)index * numActions);
+            
             //Obtain previous value
             previousV = getValue(s);
             //Now update using the value of the action with the *best* outcome            
@@ -83,9 +103,959 @@ void VI::Plan(double error){
     
     }while(delta > error); //Stop when no values differ by more than the permitted error
     
+    backups = (long)iter * numStates;
+    policyValid = true;
     cout << "VI finished after " << iter << " iterations." << endl;
 }
 
+/*
+ * Compile the maze into a sparse transition model.  This is done only once, since the maze does not change during planning.
+ */
+void VI::Compile(){
+    if(model) return;
+    
+    model = new SparseMDP(*maze);
+    cout << "Compiled " << model->getNumStates() << " states and " << model->getNumTransitions() << " transitions in "
+         << model->getBuildTime() << " ms (" << model->getMemory() / (1024.0*1024.0) << " MB)." << endl;
+}
+
+void VI::PlanSparse(){
+    PlanSparse(PlanParams.error);
+}
+
+/*
+ * Perform value iteration with given error, sweeping only the compiled model.
+ * With the default row-major order and no alternation, states are backed up in place and in the same order as Plan, so the resulting values are identical.
+ */
+void VI::PlanSparse(double error){
+    Compile();
+    
+    vector<int> order;
+    Order(order);
+    bool alternate = PlanParams.alternate;
+    
+    double previousV;
+    double delta = 0.0;
+    int iter = 0;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    do{
+        delta = 0.0;
+        //Odd iterations run backwards if sweeps alternate
+        bool backwards = alternate && (iter % 2 == 1);
+        for(int i=0; i < numStates; i++){
+            int s = backwards ? order[numStates - 1 - i] : order[i];
+            previousV = V[s];
+            int a = 0;
+            V[s] = model->Backup(V, s, PlanParams.discount, &a);
+            greedy[s] = a;
+            delta = std::max( delta, std::abs(previousV - V[s]) );
+        }
+        iter++;
+    }while(delta > error);
+    policyValid = !PlanParams.storeQ; //Q-values are not recorded
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    double sweepTime = std::chrono::duration<double, std::milli>(stop - start).count();
+    backups = (long)iter * numStates;
+    cout << "Sparse VI (" << PlanParams.order << " order" << (alternate ? ", alternating" : "") << ") finished after "
+         << iter << " iterations in " << sweepTime << " ms (" << sweepTime / iter << " ms per sweep)." << endl;
+}
+
+/*
+ * Compute the order in which states are backed up:
+ * - rowmajor: the order of Maze::listStates.
+ * - goal: breadth-first search from the goal over the predecessor lists, so every state is backed up after the successor through which value reaches it.  States that cannot reach the goal are appended in row-major order.
+ */
+void VI::Order(vector<int>& order){
+    order.clear();
+    if(PlanParams.order != "goal"){
+        for(int s=0; s < numStates; s++) order.push_back(s);
+        return;
+    }
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    model->BuildPredecessors();
+    
+    vector<bool> visited(numStates, false);
+    int goal = model->getIndex(maze->getGoal());
+    order.push_back(goal);
+    visited[goal] = true;
+    
+    //The order vector doubles as the BFS queue
+    for(int head=0; head < order.size(); head++){
+        int s = order[head];
+        for(int i=model->predBegin(s); i < model->predEnd(s); i++){
+            int p = model->getPredecessor(i);
+            if(!visited[p]){
+                visited[p] = true;
+                order.push_back(p);
+            }
+        }
+    }
+    
+    int reached = order.size();
+    for(int s=0; s < numStates; s++)
+        if(!visited[s]) order.push_back(s);
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    cout << "Goal-outward order computed in " << std::chrono::duration<double, std::milli>(stop - start).count() << " ms ("
+         << reached << " of " << numStates << " states reach the goal)." << endl;
+}
+
+void VI::PlanParallel(){
+    PlanParallel(PlanParams.error);
+}
+
+/*
+ * Perform value iteration with given error, splitting the grid into row bands across a pool of threads.
+ * 
+ * Results do not depend on the number of threads:
+ * - jacobi: every sweep reads only the values of the previous sweep (double-buffered V).
+ * - redblack: cells with even (row+col) are updated first, then odd ones.  Each half-sweep only reads values of the other color (or the cell itself), so it is in-place and race free.  This is faster to converge than Jacobi, but requires transitions to neighbouring cells only.
+ * The residual of each band is kept separately and reduced with max after every sweep.
+ */
+void VI::PlanParallel(double error){
+    policyValid = false;
+    Compile();
+    
+    int numThreads = PlanParams.threads > 0 ? PlanParams.threads : std::thread::hardware_concurrency();
+    int rows = maze->getRows();
+    int cols = maze->getCols();
+    numThreads = std::max(1, std::min(numThreads, rows));
+    
+    bool redBlack = (PlanParams.sweep == "redblack");
+    if(redBlack && !bipartite()){
+        cout << "Transitions are not restricted to neighbouring cells, using Jacobi sweeps instead of red-black." << endl;
+        redBlack = false;
+    }
+    
+    ThreadPool pool(numThreads);
+    vector<double> bandDelta(numThreads);
+    double * nextV = redBlack ? V : new double[numStates];
+    double discount = PlanParams.discount;
+    int color = 0;
+    
+    //Update all cells of the current color in band id (rows are split evenly)
+    std::function<void(int)> sweepBand = [&](int id){
+        int firstRow = (long)rows * id / numThreads;
+        int lastRow = (long)rows * (id+1) / numThreads;
+        double delta = bandDelta[id];
+        
+        for(int r=firstRow; r < lastRow; r++){
+            int s = r * cols;
+            int c = 0;
+            int step = 1;
+            if(redBlack){
+                c = (r + color) % 2;
+                step = 2;
+            }
+            for(; c < cols; c += step){
+                double v = model->Backup(V, s + c, discount);
+                delta = std::max( delta, std::abs(v - V[s + c]) );
+                nextV[s + c] = v;
+            }
+        }
+        bandDelta[id] = delta;
+    };
+    
+    double delta;
+    int iter = 0;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    do{
+        std::fill(bandDelta.begin(), bandDelta.end(), 0.0);
+        for(color = 0; color < (redBlack ? 2 : 1); color++)
+            pool.Run(sweepBand);
+        
+        delta = *std::max_element(bandDelta.begin(), bandDelta.end());
+        if(!redBlack) std::swap(V, nextV);
+        iter++;
+    }while(delta > error);
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    if(!redBlack) delete[] nextV;
+    
+    double sweepTime = std::chrono::duration<double, std::milli>(stop - start).count();
+    backups = (long)iter * numStates;
+    cout << "Parallel VI (" << (redBlack ? "red-black" : "Jacobi") << ", " << numThreads << " threads) finished after "
+         << iter << " iterations in " << sweepTime << " ms (" << sweepTime / iter << " ms per sweep)." << endl;
+}
+
+void VI::PlanStencil(){
+    PlanStencil(PlanParams.error);
+}
+
+/*
+ * Store a row of backed up values, rounded to nearest.
+ * bfloat16 is rounded stochastically instead, since rounding to nearest loses the small updates near the fixed point, see RoundStochastic
+ */
+template<typename T>
+static void StoreRow(const double * row, T * values, int cols, uint64_t& seed){
+    std::copy(row, row + cols, values);
+}
+
+static void StoreRow(const double * row, BFloat16 * values, int cols, uint64_t& seed){
+    for(int c=0; c < cols; c++)
+        values[c] = RoundStochastic(row[c], 7, seed);
+}
+
+/*
+ * Grid VI over values stored as T.
+ * Each row is backed up in double from the current values into a buffer and then stored, so rows are updated in place (Gauss-Seidel) but cells within a row are updated simultaneously (Jacobi).
+ * The residual is computed in double before rounding.  Rounding noise keeps the residual of lower precisions above some floor, so if patience > 0, planning also stops (floor = true) when the residual has not improved for patience sweeps.
+ */
+template<typename T>
+int VI::SolveStencil(T * values, double error, int patience, bool& floor){
+    int rows = maze->getRows();
+    int cols = maze->getCols();
+    vector<double> row(cols);
+    uint64_t seed = 88172645463325252ull;
+    double delta;
+    double best = Infinity;
+    int stalled = 0;
+    int iter = 0;
+    floor = false;
+    
+    do{
+        delta = 0.0;
+        for(int r=0; r < rows; r++){
+            delta = std::max( delta, stencil->BackupRow(values, row.data(), r) );
+            StoreRow(row.data(), values + r*cols, cols, seed);
+        }
+        iter++;
+        
+        if(delta < best){
+            best = delta;
+            stalled = 0;
+        }
+        else if(patience > 0 && ++stalled >= patience){
+            floor = true;
+            break;
+        }
+    }while(delta > error);
+    return iter;
+}
+
+/*
+ * Perform value iteration with given error using the grid stencil kernel
+ */
+void VI::PlanStencil(double error){
+    policyValid = false;
+    if(!stencil) stencil = new Stencil(*maze, PlanParams.discount);
+    
+    bool floor;
+    auto start = std::chrono::high_resolution_clock::now();
+    int iter = SolveStencil(V, error, 0, floor);
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    double sweepTime = std::chrono::duration<double, std::milli>(stop - start).count();
+    backups = (long)iter * numStates;
+    cout << "Stencil VI (" << (stencil->hasAVX2() ? "AVX2" : "scalar") << ") finished after " << iter << " iterations in "
+         << sweepTime << " ms (" << sweepTime / iter << " ms per sweep)." << endl;
+}
+
+/*
+ * One sweep of PlanStencil over V.  Returns the max. residual max|TV - V|
+ */
+double VI::Sweep(){
+    int rows = maze->getRows();
+    int cols = maze->getCols();
+    vector<double> row(cols);
+    double residual = 0.0;
+    
+    for(int r=0; r < rows; r++){
+        residual = std::max( residual, stencil->BackupRow(V, row.data(), r) );
+        std::copy(row.begin(), row.end(), V + r*cols);
+    }
+    return residual;
+}
+
+void VI::PlanSOR(){
+    PlanSOR(PlanParams.error);
+}
+
+/*
+ * Perform value iteration with given error using successive over-relaxation of the stencil sweeps: every row moves omega times as far as the backup, V += omega*(TV - V).
+ * Cells within a row are updated simultaneously (Jacobi), and two neighbours in a row whose greedy actions point at each other (e.g. the goal and the cell the agent steps out to) have the error mode V(a) = -V(b), which decays by 1 - omega*(1 + gamma) per sweep.
+ * That bounds omega by 2/(1 + gamma), the default (omega = 0).  On maze1000.prob (gamma = 0.99) omega = 1.01 converges and 1.02 diverges, so the speedup over stencil VI is small.
+ * Safeguard: once per sweep, the residual is compared to the smallest residual so far.  If it is more than 10 times larger, V is restored to the last checkpoint and omega is halved towards 1.
+ */
+void VI::PlanSOR(double error){
+    policyValid = false;
+    if(!stencil) stencil = new Stencil(*maze, PlanParams.discount);
+    
+    int rows = maze->getRows();
+    int cols = maze->getCols();
+    vector<double> row(cols);
+    double omega = PlanParams.omega > 0 ? PlanParams.omega : 2.0 / (1.0 + PlanParams.discount);
+    double initial = omega;
+    double residual, best = Infinity;
+    int iter = 0;
+    int backoffs = 0; //Times omega was lowered
+    
+    //Checkpoint of V, taken at most every checkpointSweeps sweeps when the residual reaches a new minimum
+    const int checkpointSweeps = 50;
+    vector<double> checkpoint(V, V + numStates);
+    double checkpointBest = Infinity;
+    int checkpointIter = 0;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    do{
+        residual = 0.0;
+        for(int r=0; r < rows; r++){
+            residual = std::max(residual, stencil->BackupRow(V, row.data(), r));
+            double * v = V + r*cols;
+            if(omega == 1.0)
+                std::copy(row.begin(), row.end(), v);
+            else
+                for(int c=0; c < cols; c++) v[c] += omega * (row[c] - v[c]);
+        }
+        iter++;
+        
+        //While values propagate from the goal the residual may grow for a few sweeps, even if SOR converges
+        if(omega != 1.0 && residual > 10 * best){
+            std::copy(checkpoint.begin(), checkpoint.end(), V);
+            best = checkpointBest;
+            omega = (omega - 1.0 < 1e-3) ? 1.0 : 1.0 + 0.5 * (omega - 1.0);
+            backoffs++;
+            residual = Infinity; //Not converged
+            continue;
+        }
+        if(residual < best){
+            best = residual;
+            if(omega != 1.0 && iter - checkpointIter >= checkpointSweeps){
+                std::copy(V, V + numStates, checkpoint.begin());
+                checkpointBest = best;
+                checkpointIter = iter;
+            }
+        }
+    }while(residual > error);
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    double sweepTime = std::chrono::duration<double, std::milli>(stop - start).count();
+    backups = (long)iter * numStates;
+    cout << "SOR VI (omega = " << initial << ") finished after " << iter << " iterations in " << sweepTime << " ms (" << sweepTime / iter << " ms per sweep)";
+    if(backoffs)
+        cout << ", omega lowered " << backoffs << " times to " << omega;
+    cout << "." << endl;
+}
+
+int VI::PlanAnderson(){
+    return PlanAnderson(PlanParams.error);
+}
+
+/*
+ * Perform value iteration with given error using Anderson acceleration of k = PlanParams.period stencil sweeps, G = T^k.
+ * Each mixing step computes g = G(x) and the residual f = g - x, and the next iterate is g minus the combination of the last m differences of g that best cancels f:
+ *   x' = g - dG*c,  where c minimizes |f - dF*c|  (dF, dG: differences of consecutive f and g)
+ * A mixing step reads and writes several grid-sized arrays, which costs more than a sweep, so mixing only every k sweeps keeps its cost small.  The Gram matrix dF^T dF is updated by one column per step.
+ * Safeguard: if the residual grows after a mixing step, the step is undone and the history is discarded.  Returns the no. of times this happened.
+ * On mazeUCT.prob and mazeEnclosed.prob it needs 2 to 10 times fewer sweeps than stencil VI.  On maze1000.prob it saves about 12% of the sweeps, which the mixing steps cost back.
+ */
+int VI::PlanAnderson(double error){
+    policyValid = false;
+    if(!stencil) stencil = new Stencil(*maze, PlanParams.discount);
+    
+    int m = std::max(1, PlanParams.history);
+    int period = std::max(1, PlanParams.period);
+    size_t n = numStates;
+    vector<double> x(V, V + n), prevF(n), prevG(n);
+    vector<double> dF((size_t)m * n), dG((size_t)m * n); //Circular history, column j at j*n
+    vector<double> gram(m*m); //dF^T dF
+    vector<double> A(m*m), c(m);
+    const size_t Block = 2048; //Cells per block of the mixing step, small enough for the block of every column to stay in cache
+    int stored = 0; //Columns in the history
+    int slot = 0; //Next column to overwrite, reset with stored so that the history is always columns 0...stored-1
+    
+    double residual, previous = Infinity;
+    int iter = 0;
+    int accelerated = 0; //Iterations that used the history
+    int restarts = 0; //Times the safeguard discarded the history
+    bool mixed = false; //x is the result of a mixing step
+    bool unset = true; //prevF and prevG are not set
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    while(true){
+        //V holds x and becomes g = G(x)
+        residual = Infinity;
+        for(int j=0; j < period && residual > error; j++){
+            residual = Sweep();
+            iter++;
+        }
+        if(residual <= error) break;
+        
+        //Safeguard: a mixing step that increased the residual is undone, i.e. x is reset to the previous g
+        if(mixed && residual > previous){
+            std::copy(prevG.begin(), prevG.end(), V);
+            std::copy(V, V + n, x.begin());
+            stored = 0;
+            slot = 0;
+            mixed = false;
+            unset = true;
+            restarts++;
+            continue;
+        }
+        //While values propagate from the goal the residual of plain sweeps may grow, the history is not used then
+        bool add = !unset;
+        if(residual > previous){
+            stored = 0;
+            slot = 0;
+            add = false;
+        }
+        previous = residual;
+        unset = false;
+        
+        if(!add){
+            std::copy(V, V + n, prevG.begin());
+            for(size_t i=0; i < n; i++) prevF[i] = V[i] - x[i];
+            std::copy(V, V + n, x.begin());
+            mixed = false;
+            continue;
+        }
+        
+        //f = g - x, the new differences of f and g (column slot), the new column of the Gram matrix and dF^T f.
+        //Block by block, so that every block is read from memory once
+        assert(stored == m || slot == stored); //Until the history is full the new column follows the stored ones
+        stored = std::min(stored + 1, m);
+        double * newF = dF.data() + (size_t)slot * n;
+        double * newG = dG.data() + (size_t)slot * n;
+        std::fill(c.begin(), c.end(), 0.0);
+        for(int j=0; j < stored; j++) gram[slot*m + j] = 0.0;
+        for(size_t first=0; first < n; first += Block){
+            size_t last = std::min(n, first + Block);
+            for(size_t i=first; i < last; i++){
+                double f = V[i] - x[i];
+                newF[i] = f - prevF[i];
+                newG[i] = V[i] - prevG[i];
+                prevF[i] = f;
+                prevG[i] = V[i];
+            }
+            for(int j=0; j < stored; j++){
+                const double * col = dF.data() + (size_t)j * n;
+                double dot = 0.0, rhs = 0.0;
+                for(size_t i=first; i < last; i++){
+                    dot += newF[i] * col[i];
+                    rhs += col[i] * prevF[i];
+                }
+                gram[slot*m + j] += dot;
+                c[j] += rhs;
+            }
+        }
+        for(int j=0; j < stored; j++) gram[j*m + slot] = gram[slot*m + j];
+        slot = (slot + 1) % m;
+        
+        //Solve the (slightly regularized) normal equations (dF^T dF) c = dF^T f by Gaussian elimination
+        double scale = 0.0;
+        for(int j=0; j < stored; j++)
+            scale = std::max(scale, gram[j*m + j]);
+        for(int j=0; j < stored; j++){
+            for(int k=0; k < stored; k++) A[j*m + k] = gram[j*m + k];
+            A[j*m + j] += 1e-10 * scale;
+        }
+        for(int j=0; j < stored; j++){
+            int pivot = j;
+            for(int k=j+1; k < stored; k++)
+                if(std::abs(A[k*m + j]) > std::abs(A[pivot*m + j])) pivot = k;
+            for(int k=0; k < stored; k++) std::swap(A[j*m + k], A[pivot*m + k]);
+            std::swap(c[j], c[pivot]);
+            for(int k=j+1; k < stored; k++){
+                double factor = A[k*m + j] / A[j*m + j];
+                for(int l=j; l < stored; l++) A[k*m + l] -= factor * A[j*m + l];
+                c[k] -= factor * c[j];
+            }
+        }
+        for(int j=stored-1; j >= 0; j--){
+            for(int k=j+1; k < stored; k++) c[j] -= A[j*m + k] * c[k];
+            c[j] /= A[j*m + j];
+        }
+        
+        //x' = g - dG*c
+        for(size_t first=0; first < n; first += Block){
+            size_t last = std::min(n, first + Block);
+            for(int j=0; j < stored; j++){
+                const double * col = dG.data() + (size_t)j * n;
+                for(size_t i=first; i < last; i++) V[i] -= c[j] * col[i];
+            }
+            std::copy(V + first, V + last, x.begin() + first);
+        }
+        mixed = true;
+        accelerated++;
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    double sweepTime = std::chrono::duration<double, std::milli>(stop - start).count();
+    backups = (long)iter * numStates;
+    cout << "Anderson VI (history = " << m << ", mixing every " << period << " sweeps) finished after " << iter << " iterations in " << sweepTime << " ms (" << sweepTime / iter << " ms per sweep, "
+         << accelerated << " accelerated, " << restarts << " restarts)." << endl;
+    return restarts;
+}
+
+void VI::PlanPrioritized(){
+    PlanPrioritized(PlanParams.error);
+}
+
+/*
+ * Prioritized sweeping: back up states in order of decreasing Bellman residual.
+ * 
+ * After a backup changes V(s) by more than the threshold, the residuals of the predecessors of s are recomputed and they are queued again.  Queue entries are not removed when a state is re-queued; outdated entries are recognised by comparing them to the current priority and skipped.
+ * Changes below the threshold are not propagated, so once the queue is empty a verification sweep recomputes all residuals and queues those above the error.  Planning stops when this sweep finds none.
+ */
+void VI::PlanPrioritized(double error){
+    policyValid = false;
+    Compile();
+    model->BuildPredecessors();
+    
+    double threshold = PlanParams.threshold > 0 ? PlanParams.threshold : error;
+    double discount = PlanParams.discount;
+    vector<double> priority(numStates, 0.0);
+    std::priority_queue< std::pair<double, int> > queue;
+    long evaluations = 0; //Residuals computed without updating V
+    int verifications = 0;
+    backups = 0;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    while(true){
+        //Verification sweep: queue every state whose residual is above the error
+        for(int s=0; s < numStates; s++){
+            priority[s] = std::abs(model->Backup(V, s, discount) - V[s]);
+            if(priority[s] > error)
+                queue.push(std::make_pair(priority[s], s));
+        }
+        evaluations += numStates;
+        verifications++;
+        if(queue.empty()) break;
+        
+        while(!queue.empty()){
+            std::pair<double, int> top = queue.top();
+            queue.pop();
+            int s = top.second;
+            if(top.first != priority[s]) continue; //Outdated entry
+            
+            double previousV = V[s];
+            V[s] = model->Backup(V, s, discount);
+            priority[s] = 0.0;
+            backups++;
+            
+            if(std::abs(V[s] - previousV) <= threshold) continue;
+            
+            for(int i=model->predBegin(s); i < model->predEnd(s); i++){
+                int p = model->getPredecessor(i);
+                double residual = std::abs(model->Backup(V, p, discount) - V[p]);
+                evaluations++;
+                if(residual > error && residual != priority[p]){
+                    priority[p] = residual;
+                    queue.push(std::make_pair(residual, p));
+                }
+            }
+        }
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    double sweepTime = std::chrono::duration<double, std::milli>(stop - start).count();
+    cout << "Prioritized sweeping finished after " << backups << " backups (" << (double)backups / numStates << " per state), "
+         << evaluations << " residual evaluations and " << verifications << " verification sweeps in " << sweepTime << " ms." << endl;
+}
+
+void VI::Replan(const double * values, const vector<State>& changed){
+    Replan(values, changed, PlanParams.error);
+}
+
+/*
+ * Incremental re-planning after the maze was edited (traps added or removed with Maze::setTrap, or the goal moved with Maze::setGoal, in which case both the old and new goal belong in changed).
+ * values should have converged for the maze before the edits.  An edit only changes the backups of the edited cell and its four neighbours, so only these are queued at first.
+ * States are then backed up in order of decreasing residual with the stencil backup.  Whenever V(s) changes, the residuals of the neighbours of s (its predecessors) are recomputed, so every state outside the queue has a residual below the error and no verification sweep is needed.
+ * The compiled sparse model is discarded, since it no longer matches the maze.
+ */
+void VI::Replan(const double * values, const vector<State>& changed, double error){
+    policyValid = false;
+    if(values != V) setValues(values);
+    delete model;
+    model = 0;
+    if(stencil)
+        stencil->Update(*maze, changed);
+    else
+        stencil = new Stencil(*maze, PlanParams.discount);
+    
+    int rows = maze->getRows();
+    int cols = maze->getCols();
+    const int dr[5] = {0, -1, 1, 0, 0};
+    const int dc[5] = {0, 0, 0, -1, 1};
+    vector<double> priority(numStates, 0.0);
+    std::priority_queue< std::pair<double, int> > queue;
+    long evaluations = 0;
+    backups = 0;
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    //Queue the edited cells and their neighbours
+    for(const State& s : changed){
+        for(int i=0; i < 5; i++){
+            int r = s.row + dr[i];
+            int c = s.col + dc[i];
+            if(r < 0 || r >= rows || c < 0 || c >= cols) continue;
+            int p = r*cols + c;
+            double residual = std::abs(stencil->Backup(V, r, c) - V[p]);
+            evaluations++;
+            if(residual > error && residual != priority[p]){
+                priority[p] = residual;
+                queue.push(std::make_pair(residual, p));
+            }
+        }
+    }
+    
+    while(!queue.empty()){
+        std::pair<double, int> top = queue.top();
+        queue.pop();
+        int s = top.second;
+        if(top.first != priority[s]) continue; //Outdated entry
+        
+        int row = s / cols;
+        int col = s % cols;
+        double previousV = V[s];
+        V[s] = stencil->Backup(V, row, col);
+        priority[s] = 0.0;
+        backups++;
+        if(V[s] == previousV) continue;
+        
+        for(int i=0; i < 5; i++){
+            int r = row + dr[i];
+            int c = col + dc[i];
+            if(r < 0 || r >= rows || c < 0 || c >= cols) continue;
+            int p = r*cols + c;
+            double residual = std::abs(stencil->Backup(V, r, c) - V[p]);
+            evaluations++;
+            if(residual > error && residual != priority[p]){
+                priority[p] = residual;
+                queue.push(std::make_pair(residual, p));
+            }
+        }
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    double time = std::chrono::duration<double, std::milli>(stop - start).count();
+    cout << "Re-planning after " << changed.size() << " edits finished after " << backups << " backups (" << (double)backups / numStates
+         << " per state) and " << evaluations << " residual evaluations in " << time << " ms." << endl;
+}
+
+/*
+ * Breadth-first search over the transitions with positive probability
+ */
+void VI::Reachable(const State& start, vector<int>& states){
+    int cols = maze->getCols();
+    vector<char> visited(numStates, 0);
+    vector<int> queue;
+    vector<State> nextStates;
+    vector<double> reward;
+    vector<float> probability;
+    
+    queue.push_back(start.row * cols + start.col);
+    visited[queue[0]] = 1;
+    for(size_t i=0; i < queue.size(); i++){
+        State s(queue[i] / cols, queue[i] % cols);
+        for(int a=0; a < numActions; a++){
+            maze->expandMDP(s, a, nextStates, reward, probability);
+            for(int s_p=0; s_p < nextStates.size(); s_p++){
+                int next = nextStates[s_p].row * cols + nextStates[s_p].col;
+                if(probability[s_p] > 0 && !visited[next]){
+                    visited[next] = 1;
+                    queue.push_back(next);
+                }
+            }
+            nextStates.clear();
+            reward.clear();
+            probability.clear();
+        }
+    }
+    
+    states.clear();
+    for(int s=0; s < numStates; s++)
+        if(visited[s]) states.push_back(s);
+}
+
+void VI::PlanReachable(){
+    PlanReachable(PlanParams.error);
+}
+
+/*
+ * Perform value iteration with given error over the states reachable from the start state only.
+ * The reachable states are compiled into a compact sparse model and swept in row-major order, like PlanSparse.  The values (and greedy actions) of unreachable states are left at 0.
+ */
+void VI::PlanReachable(double error){
+    policyValid = false;
+    State start = PlanParams.startstate ? *PlanParams.startstate : State(0, 0);
+    
+    auto start_t = std::chrono::high_resolution_clock::now();
+    Reachable(start, reachable);
+    auto search_t = std::chrono::high_resolution_clock::now();
+    SparseMDP compact(*maze, reachable);
+    
+    int n = compact.getNumStates();
+    vector<double> values(n, 0.0);
+    vector<int> actions(n, 0);
+    double previousV;
+    double delta;
+    int iter = 0;
+    
+    auto solve_t = std::chrono::high_resolution_clock::now();
+    do{
+        delta = 0.0;
+        for(int s=0; s < n; s++){
+            previousV = values[s];
+            values[s] = compact.Backup(values.data(), s, PlanParams.discount, &actions[s]);
+            delta = std::max( delta, std::abs(previousV - values[s]) );
+        }
+        iter++;
+    }while(delta > error);
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    std::fill(V, V + numStates, 0.0);
+    std::fill(greedy.begin(), greedy.end(), 0);
+    for(int s=0; s < n; s++){
+        V[reachable[s]] = values[s];
+        greedy[reachable[s]] = actions[s];
+    }
+    policyValid = !PlanParams.storeQ;
+    backups = (long)iter * n;
+    
+    cout << "Reachable from " << start << ": " << n << " of " << numStates << " states (" << 100.0 * (numStates - n) / numStates << "% pruned), search took "
+         << std::chrono::duration<double, std::milli>(search_t - start_t).count() << " ms, compilation " << compact.getBuildTime() << " ms." << endl;
+    cout << "Reachable VI finished after " << iter << " iterations in " << std::chrono::duration<double, std::milli>(stop - solve_t).count() << " ms." << endl;
+}
+
+bool VI::PlanDistributed(){
+    return PlanDistributed(PlanParams.error);
+}
+
+/*
+ * Perform value iteration with given error in PlanParams.workers processes, each sweeping one strip of rows (see DistributedVI).
+ * Returns false if the workers could not be started or failed, in which case V is not a solution
+ */
+bool VI::PlanDistributed(double error){
+    policyValid = false;
+    if(!stencil) stencil = new Stencil(*maze, PlanParams.discount);
+    
+    DistributedVI distributed(*stencil, PlanParams.workers);
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = distributed.Plan(V, error);
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    double time = std::chrono::duration<double, std::milli>(stop - start).count();
+    backups = (long)distributed.getIterations() * numStates;
+    if(!ok){
+        std::cerr << "Distributed VI failed after " << distributed.getIterations() << " iterations." << endl;
+        return false;
+    }
+    cout << "Distributed VI (" << distributed.getWorkers() << " workers) finished after " << distributed.getIterations() << " iterations in "
+         << time << " ms, " << distributed.getHaloBytes() / 1e6 << " MB of halo rows exchanged." << endl;
+    return true;
+}
+
+void VI::PlanPrecision(){
+    PlanPrecision(PlanParams.error);
+}
+
+/*
+ * Print the results of grid VI in precision T, compared to the greedy policy and values in double
+ */
+template<typename T>
+static void ReportPrecision(const char * name, const Stencil& stencil, const T * values, int iter, bool floor, double sweepTime, const vector<int>& policy, const double * V){
+    int numStates = policy.size();
+    int cols = stencil.getCols();
+    
+    int changed = 0;
+    double maxDiff = 0.0;
+    for(int s=0; s < numStates; s++){
+        int a = 0;
+        stencil.Backup(values, s / cols, s % cols, &a);
+        if(a != policy[s]) changed++;
+        maxDiff = std::max(maxDiff, std::abs((double)values[s] - V[s]));
+    }
+    
+    double bytes = sizeof(T) + (double)stencil.getMemory() / numStates;
+    double throughput = (double)numStates * iter / sweepTime / 1000; //Million cells per s
+    
+    cout << std::left << std::setw(10) << name
+         << std::setw(8) << iter << std::setw(8) << (floor ? "floor" : "error")
+         << std::setw(10) << bytes << std::setw(14) << throughput
+         << std::setw(10) << changed << std::setw(14) << maxDiff << std::right << endl;
+}
+
+/*
+ * Perform grid VI from V = 0 with the values stored in double, float and bfloat16 precision.
+ * float and bfloat16 stop at the precision floor if the residual has not improved for 2/(1-gamma) sweeps, in which VI shrinks the error by about e^2.  Stopping earlier leaves the slowly converging cells far from V*.
+ * Reports bytes per state (values plus trap mask), sweep throughput and the difference to the double precision policy and values.  V is set to the double precision result.
+ */
+void VI::PlanPrecision(double error){
+    policyValid = false;
+    if(!stencil) stencil = new Stencil(*maze, PlanParams.discount);
+    
+    int patience = (int)std::ceil(2 / (1 - PlanParams.discount));
+    vector<float> valuesF(numStates, 0.0f);
+    vector<BFloat16> valuesB(numStates);
+    std::fill(V, V + numStates, 0.0);
+    
+    int iter[3];
+    bool floor[3];
+    auto start = std::chrono::high_resolution_clock::now();
+    iter[0] = SolveStencil(V, error, 0, floor[0]);
+    auto stopD = std::chrono::high_resolution_clock::now();
+    iter[1] = SolveStencil(valuesF.data(), error, patience, floor[1]);
+    auto stopF = std::chrono::high_resolution_clock::now();
+    iter[2] = SolveStencil(valuesB.data(), error, patience, floor[2]);
+    auto stopB = std::chrono::high_resolution_clock::now();
+    
+    int cols = maze->getCols();
+    vector<int> policy(numStates);
+    for(int s=0; s < numStates; s++)
+        stencil->Backup(V, s / cols, s % cols, &policy[s]);
+    
+    cout << std::left << std::setw(10) << "Type" << std::setw(8) << "Sweeps" << std::setw(8) << "Stop" << std::setw(10) << "B/state"
+         << std::setw(14) << "Mcells/s" << std::setw(10) << "Policy" << std::setw(14) << "Max. diff." << std::right << endl;
+    ReportPrecision("double", *stencil, V, iter[0], floor[0], std::chrono::duration<double, std::milli>(stopD - start).count(), policy, V);
+    ReportPrecision("float", *stencil, valuesF.data(), iter[1], floor[1], std::chrono::duration<double, std::milli>(stopF - stopD).count(), policy, V);
+    ReportPrecision("bfloat16", *stencil, valuesB.data(), iter[2], floor[2], std::chrono::duration<double, std::milli>(stopB - stopF).count(), policy, V);
+    
+    backups = (long)(iter[0] + iter[1] + iter[2]) * numStates;
+}
+
+/*
+ * Interval VI
+ * L starts at rMin/(1-gamma) and U at rMax/(1-gamma), so L <= V* <= U.  The Bellman backup is monotone, so backing up both arrays keeps them on either side of V* while the gap shrinks by at least gamma per sweep.
+ * Unlike the max. residual, the gap U - L bounds the error of V.  V is set to (L + U)/2, which is within gap/2 of V*.
+ * The policy is greedy under L rather than V: in a certified state it is the certified action, and in any state its value is within gamma*gap of optimal, since Q*(s,a) >= Q_L(s,a).
+ * Besides the gap, interval VI stops as soon as the greedy action is certified in the start state (certify = start) or in every state (certify = all).
+ * Actions whose values differ by less than the value error are ties, so the greedy action of a tied state is certified once it is within error of the best.
+ */
+void VI::PlanInterval(){
+    PlanInterval(PlanParams.gap > 0 ? PlanParams.gap : PlanParams.error);
+}
+
+void VI::PlanInterval(double gap){
+    policyValid = false;
+    if(!stencil) stencil = new Stencil(*maze, PlanParams.discount);
+    
+    int rows = maze->getRows();
+    int cols = maze->getCols();
+    double step, out, trapped, atGoal;
+    maze->getRewards(step, out, trapped, atGoal);
+    double rMin = std::min(std::min(step, out), std::min(trapped, atGoal));
+    double rMax = std::max(std::max(step, out), std::max(trapped, atGoal));
+    vector<double> L(numStates, rMin / (1 - PlanParams.discount));
+    vector<double> U(numStates, rMax / (1 - PlanParams.discount));
+    vector<double> row(cols);
+    
+    //States whose greedy action is not certified yet
+    vector<int> pending;
+    if(PlanParams.certify == "all")
+        for(int s=0; s < numStates; s++) pending.push_back(s);
+    else if(PlanParams.certify == "start" && PlanParams.startstate)
+        pending.push_back(PlanParams.startstate->row * cols + PlanParams.startstate->col);
+    bool certify = !pending.empty();
+    
+    double width;
+    int iter = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    while(true){
+        width = 0.0;
+        for(int r=0; r < rows; r++){
+            stencil->BackupRow(L.data(), row.data(), r);
+            std::copy(row.begin(), row.end(), L.begin() + r*cols);
+            stencil->BackupRow(U.data(), row.data(), r);
+            std::copy(row.begin(), row.end(), U.begin() + r*cols);
+            for(int c = r*cols; c < (r+1)*cols; c++)
+                width = std::max(width, U[c] - L[c]);
+        }
+        iter++;
+        if(width <= gap) break;
+        
+        //A certified state remains certified, so only the others are checked
+        if(certify){
+            pending.erase(std::remove_if(pending.begin(), pending.end(), [&](int s){ return certified(L.data(), U.data(), s, PlanParams.error); }), pending.end());
+            if(pending.empty()) break;
+        }
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    for(int s=0; s < numStates; s++)
+        V[s] = 0.5 * (L[s] + U[s]);
+    
+    //The policy is greedy under L, so that it reports the actions certified above.  The Q-values are those of V
+    for(int r=0; r < rows; r++){
+        for(int c=0; c < cols; c++){
+            int s = r*cols + c;
+            int a = 0;
+            stencil->Backup(L.data(), r, c, &a);
+            greedy[s] = a;
+            if(PlanParams.storeQ)
+                for(int b=0; b < numActions; b++)
+                    Qtable[(size_t)s*numActions + b] = stencil->Q(V, r, c, b);
+        }
+    }
+    policyValid = true;
+    
+    double sweepTime = std::chrono::duration<double, std::milli>(stop - start).count();
+    backups = 2L * iter * numStates;
+    cout << "Interval VI finished after " << iter << " iterations in " << sweepTime << " ms, ";
+    if(certify && pending.empty())
+        cout << "greedy action certified in " << (PlanParams.certify == "all" ? "all states" : "the start state");
+    else if(certify)
+        cout << "gap below " << gap << ", " << pending.size() << " states not certified";
+    else
+        cout << "gap below " << gap;
+    cout << " (gap = " << width << ")." << endl;
+}
+
+/*
+ * The greedy action a under L is within tolerance of optimal if Q(s,a) under L is at least Q(s,b) under U minus tolerance for every other action b
+ */
+bool VI::certified(const double * L, const double * U, int s, double tolerance){
+    int r = s / maze->getCols();
+    int c = s % maze->getCols();
+    int best = 0;
+    double q = stencil->Backup(L, r, c, &best);
+    for(int a=0; a < numActions; a++)
+        if(a != best && stencil->Q(U, r, c, a) - tolerance > q) return false;
+    return true;
+}
+
+/*
+ * Red-black sweeps are only safe if no transition connects two different cells of the same color
+ */
+bool VI::bipartite(){
+    int cols = maze->getCols();
+    for(int s=0; s < numStates; s++){
+        for(int a=0; a < numActions; a++){
+            for(int t=model->begin(s, a); t < model->end(s, a); t++){
+                int s_p = model->getSuccessor(t);
+                int parity = (s/cols + s%cols + s_p/cols + s_p%cols) % 2;
+                if(s_p != s && parity == 0)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Replace V = 0 by the interpolated solution of a hierarchy of coarser mazes
+ */
+void VI::WarmStart(){
+    policyValid = false;
+    auto start = std::chrono::high_resolution_clock::now();
+    Multigrid multigrid(*maze, PlanParams.discount, PlanParams.error);
+    multigrid.WarmStart(*maze, V);
+    auto stop = std::chrono::high_resolution_clock::now();
+    
+    warmBackups = multigrid.getBackups();
+    cout << "Multigrid warm start (" << multigrid.getNumLevels() << " levels) took " << warmBackups << " coarse backups and "
+         << std::chrono::duration<double, std::milli>(stop - start).count() << " ms." << endl;
+}
+
+void VI::setValues(const double * values){
+    policyValid = false;
+    std::copy(values, values + numStates, V);
+}
+
 double VI::getValue(const State& s){    
     assert(maze->validateState(s));
     return V[s.row * maze->getCols() + s.col];
@@ -99,7 +1069,7 @@ void VI::setValue(const State& s, double v){
 /*
  * Return the vector element with maximal value
  */
-int VI::arg_max(vector<double> values){
+int VI::arg_max(const vector<double>& values){
     double best_v = -Infinity;
     double best_p = 0;
     double value = 0;
@@ -116,7 +1086,7 @@ int VI::arg_max(vector<double> values){
 /*
  * Return the maximal value
  */
-double VI::max(vector<double> values){
+double VI::max(const vector<double>& values){
     double best_v = -Infinity;
     double value = 0;
     
@@ -129,55 +1099,69 @@ double VI::max(vector<double> values){
 }
 
 /*
- * Extract the optimal policy computed by value iteration, by simply displaying for each state the action with maximal value
+ * Greedy policy extraction with the stencil backup, which breaks ties like Plan (first action with maximal value).
+ * Rows are split into bands that are processed in parallel.
+ */
+void VI::ExtractPolicy(){
+    if(!stencil) stencil = new Stencil(*maze, PlanParams.discount);
+    
+    int rows = maze->getRows();
+    int cols = maze->getCols();
+    int threads = PlanParams.threads > 0 ? PlanParams.threads : std::thread::hardware_concurrency(); //Same convention as PlanParallel
+    if(numStates < (1 << 16)) threads = 1; //Threads do not pay off for small grids
+    ThreadPool pool(threads);
+    threads = pool.getNumThreads();
+    
+    pool.Run([&](int id){
+        int first = (long)rows * id / threads;
+        int last = (long)rows * (id+1) / threads;
+        for(int r=first; r < last; r++){
+            for(int c=0; c < cols; c++){
+                int s = r*cols + c;
+                int a = 0;
+                stencil->Backup(V, r, c, &a);
+                greedy[s] = a;
+                if(PlanParams.storeQ)
+                    for(int b=0; b < numActions; b++)
+                        Qtable[(size_t)s*numActions + b] = stencil->Q(V, r, c, b);
+            }
+        }
+    });
+    policyValid = true;
+}
+
+const int8_t * VI::policy(){
+    if(!policyValid) ExtractPolicy();
+    return greedy.data();
+}
+
+const double * VI::getQ(){
+    if(!PlanParams.storeQ) return 0;
+    if(!policyValid) ExtractPolicy();
+    return Qtable.data();
+}
+
+bool VI::Export(const std::string& file){
+    return PolicyFile::Write(file, maze->getRows(), maze->getCols(), PlanParams.discount, PlanParams.error, V, policy());
+}
+
+/*
+ * Display the greedy policy, as recorded by the solver or extracted from V
  */
 void VI::DisplayPolicy(){
     DisplayPolicy(cout);
 }
 
 void VI::DisplayPolicy(std::ostream& ostr){          
-    vector<double> outcomes;
-    double sum_s_p;
-    int best_a;
-
-    vector<State> states;
-    vector<int> actions;
-    vector<State> nextStates;
-    vector<double> reward;
-    vector<float> probability;
-    
+    const int8_t * actions = policy();
     int cols = maze->getCols();
     
-    //Iterate one last time over all states to look for the best valued action
-    maze->listStates(states);
-    for(State& s : states){            
-        maze->getActions(s, actions);
-        for(auto a : actions){
-            maze->expandMDP(s, a, nextStates, reward, probability);
-            sum_s_p = 0;
-            for(int s_p=0; s_p < nextStates.size(); s_p++){
-                sum_s_p += probability[s_p] * (reward[s_p] + PlanParams.discount*getValue(nextStates[s_p]) );
-            }
-            outcomes.push_back(sum_s_p);
-                    
-            //Free memory
-            nextStates.clear();
-            reward.clear();
-            probability.clear();
-        }
-                            
-        //NOW we have the best valued action and simply display it
-        best_a = arg_max(outcomes);
+    for(int s=0; s < numStates; s++){
         ostr << "[";
-        maze->DisplayAction(actions[best_a], ostr);
+        maze->DisplayAction(actions[s], ostr);
         ostr << "]";
-                
-        //Free memory
-        outcomes.clear();
-        actions.clear();
         
         //New line when row ends
-        if(s.col == cols-1) ostr << endl;
+        if(s % cols == cols-1) ostr << endl;
     }
-    
 }
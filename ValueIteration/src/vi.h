@@ -12,11 +12,22 @@
 
 #include <vector>
 #include <iostream>
+#include <iomanip>
 #include <ostream>
 #include <cassert>
+#include <cstdint>
 #include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <string>
+#include <queue>
 #include "maze.h"
+#include "sparsemdp.h"
+#include "threadpool.h"
+#include "stencil.h"
+#include "multigrid.h"
+#include "policyfile.h"
+#include "distributedvi.h"
 
 using std::vector;
 using std::cout;
@@ -26,9 +37,22 @@ using std::endl;
  * Planning parameters
  */
 struct VI_PARAMS{
-    //State* startstate;  //Not generally used in VI
+    State* startstate = 0; //Start state, only used to prune unreachable states
     float discount; //Discount factor for expected returns
-    double error; //Convergence criteria
+    double error = 1e-8; //Convergence criteria (default if not in the problem file)
+    int threads = 1; //No. of threads for parallel VI
+    std::string sweep = "jacobi"; //Parallel update order: jacobi or redblack
+    double threshold = 0; //Min. value change propagated by prioritized sweeping (0 = error)
+    int evalSweeps = 10; //Evaluation sweeps per policy in modified policy iteration
+    std::string order = "rowmajor"; //Backup order of sparse VI: rowmajor or goal
+    bool alternate = false; //Alternate forward and backward sweeps in sparse VI
+    int workers = 2; //No. of worker processes for distributed VI
+    bool storeQ = false; //Keep the Q-values of the final sweep (numStates x numActions)
+    std::string certify = "start"; //States whose greedy action interval VI must prove optimal: start, all or none
+    double gap = 0; //Max. gap between the bounds of interval VI (0 = error)
+    double omega = 0; //Relaxation factor of SOR VI (1 = stencil VI, 0 = 2/(1 + discount))
+    int history = 2; //No. of previous iterates combined by Anderson-accelerated VI
+    int period = 20; //Stencil sweeps between the mixing steps of Anderson-accelerated VI
 };
 
 class VI{
@@ -36,18 +60,75 @@ class VI{
         VI_PARAMS PlanParams;
         double * V; //Array for state values        
         Maze * maze; //The planning domain
+        SparseMDP * model; //Compiled transition model, built on demand
+        Stencil * stencil; //Grid backup kernel, built on demand
         int numStates;
         int numActions;
+        long backups; //No. of state backups performed by the last call to Plan
+        long warmBackups; //No. of (coarse) backups spent on the warm start
+        vector<int8_t> greedy; //Greedy action in every state
+        vector<double> Qtable; //Q-values of every state-action pair, if PlanParams.storeQ
+        bool policyValid; //True if greedy (and Qtable) correspond to V
+        vector<int> reachable; //States solved by PlanReachable (empty if all states were solved)
         
-        int arg_max(vector<double> values); //Return the action with maximal value
-        double max(vector<double> values); //Return a maximal value
+        int arg_max(const vector<double>& values); //Return the action with maximal value
+        double max(const vector<double>& values); //Return a maximal value
         double getValue(const State& s); //Return the current value of state s
         void setValue(const State& s, double v); //Set the value of state s to v
+        void Order(vector<int>& order); //Compute the backup order for sparse VI
+        bool bipartite(); //True if every transition either stays put or changes the color (row+col)%2
+        bool certified(const double * L, const double * U, int s, double tolerance); //True if the greedy action in s under L is within tolerance of optimal for every V between L and U
+        double Sweep(); //One PlanStencil sweep of V, returning the max. residual
+        template<typename T> int SolveStencil(T * values, double error, int patience, bool& floor); //Grid VI over values stored as T.  Returns the no. of sweeps
         
     public:
         VI(VI_PARAMS& PlanParams, Maze * maze);
+        ~VI();
         void Plan(); //VI using the error in VI_PARAMS
         void Plan(double error); //VI using given error
+        
+        /*
+         * VI over a precompiled sparse transition model
+         */
+        void Compile(); //Build the sparse model once
+        void PlanSparse(); //Sparse VI using the error in VI_PARAMS
+        void PlanSparse(double error); //Sparse VI using given error
+        void PlanParallel(); //Multi-threaded VI using the error in VI_PARAMS
+        void PlanParallel(double error); //Multi-threaded VI using given error
+        void PlanStencil(); //Vectorised grid VI using the error in VI_PARAMS
+        void PlanStencil(double error); //Vectorised grid VI using given error
+        void PlanPrioritized(); //Prioritized sweeping using the error in VI_PARAMS
+        void PlanPrioritized(double error); //Prioritized sweeping using given error
+        void Reachable(const State& start, vector<int>& states); //List the states reachable from start, in row-major order
+        void PlanReachable(); //VI over the states reachable from PlanParams.startstate, using the error in VI_PARAMS
+        void PlanReachable(double error); //Same, using given error
+        bool PlanDistributed(); //Multi-process VI using the error in VI_PARAMS.  Returns false if the workers failed
+        bool PlanDistributed(double error); //Multi-process VI using given error.  Returns false if the workers failed
+        void PlanPrecision(); //Grid VI in double, float and bfloat16 precision, using the error in VI_PARAMS
+        void PlanPrecision(double error); //Grid VI in all precisions using given error
+        void PlanInterval(); //Grid VI with lower and upper bounds, using the gap in VI_PARAMS
+        void PlanInterval(double gap); //Same, stopping at the given gap or once the greedy actions are certified
+        void PlanSOR(); //Grid VI with successive over-relaxation, using the error in VI_PARAMS
+        void PlanSOR(double error); //Same, using given error
+        int PlanAnderson(); //Grid VI with Anderson acceleration, using the error in VI_PARAMS.  Returns the no. of safeguard restarts
+        int PlanAnderson(double error); //Same, using given error
+        
+        void WarmStart(); //Initialize V with a coarse-to-fine multigrid solution
+        void Replan(const double * values, const vector<State>& changed); //Re-converge from values after the given cells of the maze were edited, using the error in VI_PARAMS
+        void Replan(const double * values, const vector<State>& changed, double error); //Same, using given error
+        
+        void ExtractPolicy(); //Compute the greedy policy (and Q-table) from V, in PlanParams.threads threads (0 = all cores)
+        const int8_t * policy(); //Greedy action in every state, extracted only if the last solver did not record it
+        const double * getQ(); //Q-table, or 0 if PlanParams.storeQ is not set
+        
+        const double * getValues() const { return V; }
+        void setValues(const double * values); //Replace V, e.g. with the result of another planner
+        long getBackups() const { return backups; }
+        long getWarmStartBackups() const { return warmBackups; }
+        const vector<int>& getReachable() const { return reachable; }
+        
+        bool Export(const std::string& file); //Write V and the greedy policy to a binary policy file (see PolicyFile)
+        
         void DisplayPolicy(); //Print current optimal policy to stdout
         void DisplayPolicy(std::ostream& ostr); //Display optimal policy
 };
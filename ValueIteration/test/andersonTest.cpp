@@ -0,0 +1,73 @@
+/*
+ * Test for Anderson-accelerated VI.
+ *
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021).
+ *
+ * Solves a problem file with VI::Plan and with VI::PlanAnderson at the settings that make the safeguard restart most often (history 1 and 2, mixing every 2 sweeps), and fails if no restart happened, a value differs from Plan by more than the value error, or a greedy action is not within twice the value error of the best action under Plan.
+ * A history column written at the wrong place after a restart is caught by the assertion in PlanAnderson.
+ * Usage: andersonTest problemfile
+ */
+#include <iostream>
+#include <cmath>
+#include "maze.h"
+#include "vi.h"
+#include "Parser.h"
+
+using std::cout;
+using std::endl;
+
+int main(int argc, char ** argv){
+    if(argc < 2){
+        std::cerr << "Must specify problem file." << endl;
+        return -1;
+    }
+
+    PARAMS mazeParams;
+    VI_PARAMS viParams;
+    if(!PARSER::parseMaze(mazeParams, viParams, argv[1])){
+        std::cerr << "Could not parse problem file." << endl;
+        return -1;
+    }
+
+    Maze M(mazeParams);
+    int n = M.getNumStates();
+    int numActions = M.getNumActions();
+
+    VI_PARAMS refParams = viParams;
+    refParams.storeQ = true;
+    VI reference(refParams, &M);
+    reference.Plan(0);
+    const double * Q = reference.getQ();
+    const int8_t * refPolicy = reference.policy();
+
+    //A residual of error bounds the distance to the fixed point by error / (1 - discount)
+    double tolerance = 2 * viParams.error / (1 - viParams.discount);
+    bool passed = true;
+    int totalRestarts = 0;
+    for(int history=1; history <= 2; history++){
+        viParams.history = history;
+        viParams.period = 2;
+        VI anderson(viParams, &M);
+        totalRestarts += anderson.PlanAnderson();
+
+        double diff = 0.0;
+        for(int s=0; s < n; s++)
+            diff = std::max(diff, std::abs(anderson.getValues()[s] - reference.getValues()[s]));
+
+        //Actions that differ from Plan must be ties within the value error
+        int changed = 0, wrong = 0;
+        const int8_t * policy = anderson.policy();
+        for(int s=0; s < n; s++){
+            if(policy[s] == refPolicy[s]) continue;
+            changed++;
+            if(Q[s*numActions + refPolicy[s]] - Q[s*numActions + policy[s]] > 2 * tolerance) wrong++;
+        }
+        cout << "History " << history << ": max. difference = " << diff << ", greedy actions that differ: " << changed << " (not tied: " << wrong << ")" << endl;
+        passed = passed && diff <= tolerance && wrong == 0;
+    }
+
+    cout << "Safeguard restarts: " << totalRestarts << endl;
+    passed = passed && totalRestarts > 0;
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*
+ * Test for distributed VI.
+ *
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021).
+ *
+ * Solves a problem file with VI::Plan and with VI::PlanDistributed for several no. of workers, and fails if PlanDistributed returns false, a value differs from Plan by more than the value error, or a greedy action is not within twice the value error of the best action under Plan.
+ * The worker counts include one where a strip boundary cuts the rows around the goal, whose backups depend on the halo rows.  If no count up to MaxWorkers does, the goal is also moved to the middle row and solved with 2 workers.
+ * Usage: distributedTest problemfile
+ */
+#include <iostream>
+#include <cmath>
+#include "maze.h"
+#include "vi.h"
+#include "Parser.h"
+
+using std::cout;
+using std::endl;
+
+#define MaxWorkers 8
+
+/*
+ * True if a boundary between the strips of DistributedVI lies between the rows goalRow-1 and goalRow+1
+ */
+static bool CutsGoal(int rows, int workers, int goalRow){
+    for(int k=1; k < workers; k++){
+        int boundary = (long)rows * k / workers; //First row of strip k
+        if(boundary > goalRow - 1 && boundary <= goalRow + 1) return true;
+    }
+    return false;
+}
+
+/*
+ * Solve M with PlanDistributed and the given no. of workers and compare to the reference
+ */
+static bool Compare(Maze& M, VI_PARAMS viParams, int workers, VI& reference){
+    int n = M.getNumStates();
+    int numActions = M.getNumActions();
+    const double * Q = reference.getQ();
+    const int8_t * refPolicy = reference.policy();
+
+    workers = std::min(workers, M.getRows()); //As in DistributedVI
+    viParams.workers = workers;
+    VI distributed(viParams, &M);
+    if(!distributed.PlanDistributed()){
+        cout << workers << " workers: PlanDistributed failed" << endl;
+        return false;
+    }
+
+    //A max. change of error bounds the distance to the fixed point by error / (1 - discount)
+    double tolerance = 2 * viParams.error / (1 - viParams.discount);
+    double diff = 0.0;
+    for(int s=0; s < n; s++)
+        diff = std::max(diff, std::abs(distributed.getValues()[s] - reference.getValues()[s]));
+
+    //Actions that differ from Plan must be ties within the value error
+    int changed = 0, wrong = 0;
+    const int8_t * policy = distributed.policy();
+    for(int s=0; s < n; s++){
+        if(policy[s] == refPolicy[s]) continue;
+        changed++;
+        if(Q[s*numActions + refPolicy[s]] - Q[s*numActions + policy[s]] > 2 * tolerance) wrong++;
+    }
+
+    bool cut = CutsGoal(M.getRows(), workers, M.getGoal().row);
+    cout << workers << " workers" << (cut ? " (strip boundary at the goal)" : "") << ": max. difference = " << diff
+         << ", greedy actions that differ: " << changed << " (not tied: " << wrong << ")" << endl;
+    return diff <= tolerance && wrong == 0;
+}
+
+int main(int argc, char ** argv){
+    if(argc < 2){
+        std::cerr << "Must specify problem file." << endl;
+        return -1;
+    }
+
+    PARAMS mazeParams;
+    VI_PARAMS viParams;
+    if(!PARSER::parseMaze(mazeParams, viParams, argv[1])){
+        std::cerr << "Could not parse problem file." << endl;
+        return -1;
+    }
+
+    Maze M(mazeParams);
+    VI_PARAMS refParams = viParams;
+    refParams.storeQ = true;
+
+    bool passed = true;
+    bool cut = false;
+    {
+        VI reference(refParams, &M);
+        reference.Plan(0);
+        for(int workers : {1, 2, 3, 4, MaxWorkers}){
+            passed = Compare(M, viParams, workers, reference) && passed;
+            cut = cut || CutsGoal(M.getRows(), std::min(workers, M.getRows()), M.getGoal().row);
+        }
+    }
+
+    if(!cut){
+        M.setGoal(M.getRows() / 2, M.getGoal().col);
+        cout << "Goal moved to (" << M.getGoal().row << ", " << M.getGoal().col << ")" << endl;
+        VI reference(refParams, &M);
+        reference.Plan(0);
+        passed = Compare(M, viParams, 2, reference) && passed;
+    }
+
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/*
+ * Test for the grid stencil kernel.
+ *
+ * by Juan Carlos Saborio, DFKI Labor Niedersachsen (2021).
+ *
+ * Solves a problem file with VI::Plan (expandMDP backups) and with both stencil kernels, once with the default goal and once with an absorbing goal, and fails if any value differs by more than 1e-12 or the greedy policies differ.
+ * All solvers run with error 0, i.e. until a sweep changes no value, so they stop at the exact fixed point of the floating-point backup instead of at different distances from it.
+ * Usage: stencilTest problemfile
+ */
+#include <iostream>
+#include <cmath>
+#include "maze.h"
+#include "vi.h"
+#include "stencil.h"
+#include "Parser.h"
+
+using std::cout;
+using std::endl;
+
+#define Tolerance 1e-12
+
+/*
+ * Stencil VI with the selected kernel, backing up rows in place as in VI::PlanStencil
+ */
+static void SolveStencil(Stencil& kernel, vector<double>& V, int rows, int cols){
+    vector<double> row(cols);
+    double delta;
+    do{
+        delta = 0.0;
+        for(int r=0; r < rows; r++){
+            delta = std::max(delta, kernel.BackupRow(V.data(), row.data(), r));
+            std::copy(row.begin(), row.end(), V.begin() + r*cols);
+        }
+    }while(delta > 0);
+}
+
+static double MaxDiff(const double * A, const double * B, int n){
+    double maxDiff = 0.0;
+    for(int i=0; i < n; i++)
+        maxDiff = std::max(maxDiff, std::abs(A[i] - B[i]));
+    return maxDiff;
+}
+
+int main(int argc, char ** argv){
+    if(argc < 2){
+        std::cerr << "Must specify problem file." << endl;
+        return -1;
+    }
+
+    PARAMS mazeParams;
+    VI_PARAMS viParams;
+    if(!PARSER::parseMaze(mazeParams, viParams, argv[1])){
+        std::cerr << "Could not parse problem file." << endl;
+        return -1;
+    }
+
+    //Both the default goal and an absorbing goal (Maze::isTerminal)
+    bool passed = true;
+    for(int terminal=0; terminal < 2; terminal++){
+        mazeParams.terminalGoal = terminal;
+        Maze M(mazeParams);
+        int rows = M.getRows();
+        int cols = M.getCols();
+        int n = M.getNumStates();
+        cout << (terminal ? "Absorbing goal" : "Default goal") << endl;
+
+        VI reference(viParams, &M);
+        reference.Plan(0);
+
+        VI stencil(viParams, &M);
+        stencil.PlanStencil(0);
+
+        double diff = MaxDiff(reference.getValues(), stencil.getValues(), n);
+        cout << "VI::PlanStencil: max. difference = " << diff << endl;
+        passed = passed && diff <= Tolerance;
+
+        //Both kernels, whichever one PlanStencil selected
+        Stencil kernel(M, viParams.discount);
+        for(int avx2=0; avx2 < 2; avx2++){
+            kernel.setAVX2(avx2);
+            if(avx2 && !kernel.hasAVX2()) continue;
+
+            vector<double> V(n, 0.0);
+            SolveStencil(kernel, V, rows, cols);
+            diff = MaxDiff(reference.getValues(), V.data(), n);
+            cout << (avx2 ? "AVX2" : "Scalar") << " kernel: max. difference = " << diff << endl;
+            passed = passed && diff <= Tolerance;
+        }
+
+        //Both break ties like Plan, so the greedy policies agree
+        int changed = 0;
+        const int8_t * policy = stencil.policy();
+        const int8_t * refPolicy = reference.policy();
+        for(int s=0; s < n; s++)
+            if(policy[s] != refPolicy[s]) changed++;
+        cout << "Greedy actions that differ: " << changed << endl;
+        passed = passed && changed == 0;
+    }
+
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+    return passed ? 0 : 1;
+}